@@ -9,11 +9,13 @@ use warnings;
 
 =cut
 
+use Capture::Tiny qw(capture_merged);
 use English qw(-no_match_vars);
 use File::Spec::Functions;
 use File::Temp;
 use File::chdir;
 use FindBin;
+use JSON::PP;
 use Readonly;
 use ReleaseAction qw(on_release);
 use Test::More;
@@ -28,27 +30,17 @@ Readonly my $TESTDATA_DIR => catfile( $FindBin::Bin, qw(data test-projects) );
 
 Readonly my $QMAKE => find_qmake( );
 
-sub test_testplanner_on_testdata
+# Returns the command to run testplanner on the testdata with the given @args
+sub testplanner_command
 {
-    my $testplan = File::Temp->new(
-        TEMPLATE => 'qtqa-testplan-XXXXXX',
-        TMPDIR => 1,
-    );
-    $testplan = "$testplan";
-    my $cleanup = on_release { unlink $testplan };
-
-    # Put some garbage in environment variables relating to "make check", to ensure
-    # that this does _not_ affect the behavior
-    local $ENV{ TESTRUNNER } = 'some testrunner';
-    local $ENV{ TESTARGS } = 'some testargs';
+    my (@args) = @_;
 
     my @cmd = (
         $EXECUTABLE_NAME,
         $TESTPLANNER,
         '--input',
         $TESTDATA_DIR,
-        '--output',
-        "$testplan",
+        @args,
     );
 
     if ($OSNAME =~ m{win32}i) {
@@ -65,6 +57,36 @@ sub test_testplanner_on_testdata
         } # else - use default
     } # else - use default
 
+    return @cmd;
+}
+
+# Returns the (unsorted) lines of the given test plan
+sub read_lines
+{
+    my ($filename) = @_;
+
+    my $fh = IO::File->new( $filename, '<' ) || die "open $filename for read: $!";
+    my @lines = <$fh>;
+
+    return @lines;
+}
+
+sub test_testplanner_on_testdata
+{
+    my $testplan = File::Temp->new(
+        TEMPLATE => 'qtqa-testplan-XXXXXX',
+        TMPDIR => 1,
+    );
+    $testplan = "$testplan";
+    my $cleanup = on_release { unlink $testplan };
+
+    # Put some garbage in environment variables relating to "make check", to ensure
+    # that this does _not_ affect the behavior
+    local $ENV{ TESTRUNNER } = 'some testrunner';
+    local $ENV{ TESTARGS } = 'some testargs';
+
+    my @cmd = testplanner_command( '--output', "$testplan" );
+
     my $status = system( @cmd );
     is( $status, 0, 'testplanner exit code OK' );
 
@@ -102,6 +124,51 @@ sub test_testplanner_on_testdata
     return;
 }
 
+sub test_testplanner_shards
+{
+    my $tempdir = File::Temp->newdir( 'qtqa-testplanner-shards-XXXXXX', TMPDIR => 1 );
+    my $testplan = catfile( $tempdir, 'testplan.txt' );
+    my $timing_db = catfile( $tempdir, 'timings.json' );
+
+    my %seconds = (
+        'failing_custom_check_target' => 40,
+        'failing_significant_test' => 5,
+        'passing_significant_test' => 20,
+        'passing_custom_check_target' => 10,
+        'subtest (sub1)' => 10,
+        'subtest (sub2)' => 5,
+        'failing_insignificant_test' => 5,
+        'passing_insignificant_test' => 5,
+    );
+    my $fh = IO::File->new( $timing_db, '>' ) || die "open $timing_db for write: $!";
+    print $fh encode_json( {
+        version => 1,
+        tests => { map { $_ => { seconds => $seconds{ $_ }, runs => 1 } } keys %seconds },
+    } );
+    close( $fh );
+
+    my @args = ('--output', $testplan, '--shards', 2, '--timing-db', $timing_db);
+    my $status;
+    my $output = capture_merged { $status = system( testplanner_command( @args ) ) };
+    is( $status, 0, 'testplanner --shards exit code OK' ) || diag( $output );
+
+    my @all = sort( read_lines( $testplan ) );
+    my @shards = map { [ read_lines( catfile( $tempdir, "testplan.$_.txt" ) ) ] } (0, 1);
+    is_deeply( [ sort map { @{ $_ } } @shards ], \@all, 'shards contain every test exactly once' );
+
+    # 100 seconds of tests in total, of which 90 seconds serial and 10 seconds parallel
+    like( $output, qr{^Shard 0 of 2: 5 tests, estimated 50 seconds}m, 'shard 0 is balanced' );
+    like( $output, qr{^Shard 1 of 2: 3 tests, estimated 50 seconds}m, 'shard 1 is balanced' );
+
+    # selecting one shard writes only that shard, identical to the one written above
+    push @args, '--shard-index', 1;
+    $output = capture_merged { $status = system( testplanner_command( @args ) ) };
+    is( $status, 0, 'testplanner --shard-index exit code OK' ) || diag( $output );
+    is_deeply( [ sort( read_lines( $testplan ) ) ], [ sort @{ $shards[1] } ], 'selected shard as expected' );
+
+    return;
+}
+
 sub run
 {
     if (!$QMAKE) {
@@ -116,6 +183,7 @@ sub run
     }
 
     test_testplanner_on_testdata;
+    test_testplanner_shards;
     done_testing;
 
     return;
@@ -14,6 +14,8 @@ use File::Spec::Functions;
 use File::Temp;
 use File::chdir;
 use FindBin;
+use IO::File;
+use JSON::PP;
 use Readonly;
 use ReleaseAction qw(on_release);
 use Test::More;
@@ -68,6 +70,12 @@ $out{ timing_section_begin }
 [ ]+ \QEstimated time spent on insignificant tests:\E [ ]+  $out{ time_seconds } \n
     |xms;
 
+    $out{ timing_section_j4_overlapped_with_insignificant } = qr|
+$out{ timing_section_begin }
+[ ]+ \QEstimated time spent on insignificant tests:\E [ ]+  $out{ time_seconds } \n
+[ ]+ \QEstimated time saved by -j4:\E [ ]+                  $out{ time_seconds } \n
+    |xms;
+
     $out{ timing_section_j4_with_insignificant } = qr|
 $out{ timing_section_begin }
 [ ]+ \QSerial tests:\E [ ]+                                 $out{ time_seconds } \n
@@ -233,6 +241,324 @@ sub test_mixed_parallel_stress
     return;
 }
 
+sub test_mixed_overlap_serial
+{
+    my ($testplan, $unlink) = make_testplan_from_directory $TESTDATA_DIR;
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j4',
+            '--overlap-serial',
+        );
+    };
+    isnt( $status, 0, '[overlap-serial] testscheduler fails if some tests fail' );
+
+    # The order of the test output is unpredictable, as serial tests run
+    # concurrently with parallel tests.
+    unlike( $output, qr{Starting \d+ serial tests}, '[overlap-serial] no separate serial phase' );
+    like( $output, qr|
+$RE{ timing_section_j4_overlapped_with_insignificant }
+\Q=== Failures: ==================================================================
+  failing_custom_check_target
+  failing_significant_test
+  subtest (sub1)
+  subtest (sub2)
+  failing_insignificant_test [insignificant]
+=== Totals: 8 tests, 3 passes, 4 fails, 1 insignificant fail ===================
+\E
+\z|xms, '[overlap-serial] testscheduler output as expected' );
+
+    return;
+}
+
+sub test_fail_fast
+{
+    my ($testplan, $unlink) = make_testplan_from_directory $TESTDATA_DIR;
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '--fail-fast',
+        );
+    };
+    isnt( $status, 0, '[fail-fast] testscheduler fails if some tests fail' );
+    like( $output, qr|
+\A
+\QCustom failing
+QtQA::App::TestScheduler: failing_custom_check_target failed
+QtQA::App::TestScheduler: aborting: failing_custom_check_target failed and --fail-fast was given; stopping no running tests
+\E $RE{ timing_section_j1 }
+\Q=== Failures: ==================================================================
+  failing_custom_check_target
+=== Totals: 8 tests, no passes, 1 fail, 7 not run ==============================
+\E
+\z|xms, '[fail-fast] testscheduler output as expected' );
+
+    return;
+}
+
+# test running all tests on workers started with --worker-command
+sub test_mixed_workers
+{
+    my ($testplan, $unlink) = make_testplan_from_directory $TESTDATA_DIR;
+
+    my $worker_command = qq{"$EXECUTABLE_NAME" "$TESTSCHEDULER" --connect - -j2};
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j0',
+            '--worker-command',
+            $worker_command,
+            '--worker-command',
+            $worker_command,
+        );
+    };
+    isnt( $status, 0, '[workers] testscheduler fails if some tests fail' );
+
+    like( $output, qr{^\QQtQA::App::TestScheduler: worker 1 connected from \E}ms, '[workers] worker 1 connected' );
+    like( $output, qr{^\QQtQA::App::TestScheduler: worker 2 connected from \E}ms, '[workers] worker 2 connected' );
+
+    # The order of the test output is unpredictable, as tests are run by
+    # whichever worker is free first.
+    like( $output, qr|
+$RE{ timing_section_j4_with_insignificant }
+\Q=== Failures: ==================================================================
+  failing_custom_check_target
+  failing_significant_test
+  subtest (sub1)
+  subtest (sub2)
+  failing_insignificant_test [insignificant]
+=== Totals: 8 tests, 3 passes, 4 fails, 1 insignificant fail ===================
+\E
+\z|xms, '[workers] testscheduler output as expected' );
+
+    return;
+}
+
+# test that a test is run again if its worker is lost, but only once
+sub test_worker_lost
+{
+    my ($testplan, $unlink) = make_testplan_from_directory "$TESTDATA_DIR/tests/passing_significant_test";
+
+    # a worker which disconnects as soon as it is given a test
+    my $crashing_worker_command = q{echo '{"type":"hello","jobs":1,"host":"crashing"}'; read test};
+    my $worker_command = qq{"$EXECUTABLE_NAME" "$TESTSCHEDULER" --connect - -j1};
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j0',
+            '--worker-command',
+            $crashing_worker_command,
+            '--worker-command',
+            "sleep 1; $worker_command",
+        );
+    };
+    is( $status, 0, '[worker lost] testscheduler passes if the test passes on another worker' );
+    like( $output, qr{^\QQtQA::App::TestScheduler: passing_significant_test: lost worker 1 while running this test; running it again\E$}ms,
+        '[worker lost] test is run again' );
+    like( $output, qr{^\Q=== Totals: 1 test, 1 pass ===\E}ms, '[worker lost] test passed' );
+
+    $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j0',
+            '--worker-command',
+            $crashing_worker_command,
+            '--worker-command',
+            "sleep 1; $crashing_worker_command",
+            '--worker-command',
+            "sleep 3; $worker_command",
+        );
+    };
+    isnt( $status, 0, '[worker lost twice] testscheduler fails' );
+    like( $output, qr{^\QQtQA::App::TestScheduler: passing_significant_test: lost worker 2 while running this test\E$}ms,
+        '[worker lost twice] test is not run again' );
+    like( $output, qr{^\Q=== Totals: 1 test, no passes, 1 fail ===\E}ms, '[worker lost twice] test failed' );
+
+    return;
+}
+
+# test that the test run is aborted rather than waiting forever if there is nothing
+# left to run the tests
+sub test_no_workers_left
+{
+    my ($testplan, $unlink) = make_testplan_from_directory( catfile( $TESTDATA_DIR, 'parallel_tests' ) );
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j0',
+            '--worker-command',
+            'exit 1',
+        );
+    };
+    isnt( $status, 0, '[no workers] testscheduler fails' );
+    like( $output, qr|
+\A
+\QQtQA::App::TestScheduler: worker 1 disconnected
+QtQA::App::TestScheduler: aborting: no workers left to run tests; stopping no running tests
+\E
+.*
+^\Q=== Totals: 11 tests, no passes, 11 not run ===\E
+|xms, '[no workers] testscheduler output as expected' );
+
+    return;
+}
+
+# Returns true if the process $pid is gone, waiting a few seconds for it to be reaped.
+sub process_gone
+{
+    my ($pid) = @_;
+
+    foreach (1..50) {
+        return 1 if (!kill( 0, $pid ));
+        select( undef, undef, undef, 0.1 );
+    }
+
+    return 0;
+}
+
+# Returns the pid of the child process written by the last slow test.
+sub sleeping_pid
+{
+    my ($pid_file) = @_;
+
+    my $fh = IO::File->new( $pid_file, '<' ) || return;
+    my $pid = $fh->getline( ) // return;
+    chomp $pid;
+
+    return $pid;
+}
+
+# test that --deadline stops the running test along with its child processes,
+# and doesn't start any more tests
+sub test_deadline
+{
+    my ($testplan, $unlink) = make_testplan_from_directory "$TESTDATA_DIR/slow_tests";
+
+    my $dir = File::Temp->newdir( );
+    local $ENV{ SLEEP_PID_FILE } = catfile( "$dir", 'pid' );
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '--deadline',
+            '2',
+        );
+    };
+    isnt( $status, 0, '[deadline] testscheduler fails if the deadline is exceeded' );
+    like( $output, qr|
+\A
+\QQtQA::App::TestScheduler: aborting: deadline of 2 seconds exceeded; stopping 1 running test
+QtQA::App::TestScheduler: sleeping failed\E
+.*
+\Q=== Totals: 2 tests, no passes, 1 fail, 1 not run ===\E
+|xms, '[deadline] testscheduler output as expected' );
+
+    my $pid = sleeping_pid( $ENV{ SLEEP_PID_FILE } );
+    ok( $pid, '[deadline] test was started' );
+    ok( process_gone( $pid ), '[deadline] child process of the test was stopped' ) if $pid;
+
+    return;
+}
+
+# test the progress reports, both when a test completes and while tests are running
+sub test_progress
+{
+    my ($testplan, $unlink) = make_testplan_from_directory "$TESTDATA_DIR/slow_tests/sleeping";
+
+    local $ENV{ QTQA_TESTSCHEDULER_PROGRESS_INTERVAL } = 1;
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '--progress',
+            '--deadline',
+            '3',
+        );
+    };
+    isnt( $status, 0, '[progress] testscheduler fails if the deadline is exceeded' );
+    like( $output, qr|
+\A
+\QQtQA::App::TestScheduler: progress: \E$RE{ time_seconds }\Q elapsed; running: sleeping (\E$RE{ time_seconds }\Q)\E \n
+|xms, '[progress] running tests listed' );
+    like( $output, qr|
+^\QQtQA::App::TestScheduler: progress: [1/1] sleeping failed (\E$RE{ time_seconds }\Q), no tests running\E$
+|xms, '[progress] completed test reported' );
+
+    return;
+}
+
+# test that a test is killed if it keeps running long after its testcase.timeout,
+# because testrunner failed to stop it
+sub test_timeout_kill
+{
+    my ($testplan, $unlink) = make_testplan_from_directory "$TESTDATA_DIR/slow_tests/stopping_testrunner";
+
+    my $dir = File::Temp->newdir( );
+    local $ENV{ SLEEP_PID_FILE } = catfile( "$dir", 'pid' );
+    local $ENV{ QTQA_TESTSCHEDULER_TIMEOUT_GRACE_PERIOD } = 1;
+    local $ENV{ QTQA_TESTSCHEDULER_KILL_GRACE_PERIOD } = 1;
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+        );
+    };
+    isnt( $status, 0, '[timeout kill] testscheduler fails if a test is killed' );
+    like( $output, qr|
+\A
+\QQtQA::App::TestScheduler: stopping_testrunner is still running \E$RE{ time_seconds }\Q after its timeout of 1 second; killing it
+QtQA::App::TestScheduler: stopping_testrunner failed\E
+.*
+\Q=== Totals: 1 test, no passes, 1 fail ===\E
+|xms, '[timeout kill] testscheduler output as expected' );
+
+    my $pid = sleeping_pid( $ENV{ SLEEP_PID_FILE } );
+    ok( $pid, '[timeout kill] test was started' );
+    ok( process_gone( $pid ), '[timeout kill] child process of the test was stopped' ) if $pid;
+
+    return;
+}
+
 # Test what happens with a directory containing no tests
 sub test_none
 {
@@ -389,6 +715,84 @@ sub test_concurrently_limit
     return;
 }
 
+# test that tests sharing a testcase.resource_lock, and serial tests, never run concurrently.
+# All the tests fail, so that the tests run concurrently with each are listed in the output.
+sub test_resource_locks
+{
+    my ($testplan, $unlink) = make_testplan_from_directory( catfile( $TESTDATA_DIR, 'resource_locks' ) );
+
+    foreach my $args ([ '-j4' ], [ '-j4', '--overlap-serial' ]) {
+        my $status;
+        my $output = capture_merged {
+            $status = system(
+                $EXECUTABLE_NAME,
+                $TESTSCHEDULER,
+                '--plan',
+                "$testplan",
+                @{ $args },
+            );
+        };
+        isnt( $status, 0, "[resource locks @{ $args }] testscheduler fails if some tests fail" );
+
+        my %concurrent;
+        while ($output =~ m{^\QQtQA::App::TestScheduler: \E(\S+) failed(?:; run concurrently with ([^\n]+))?$}mg) {
+            $concurrent{ $1 } = { map { $_ => 1 } split( /, /, $2 // q{} ) };
+        }
+        is_deeply( [ sort keys %concurrent ], [ qw(lock1 lock2 serial1 serial2 unlocked) ],
+            "[resource locks @{ $args }] all tests ran" ) || diag $output;
+
+        ok( !$concurrent{ lock1 }{ lock2 }, "[resource locks @{ $args }] tests sharing a lock ran one at a time" );
+        ok( !$concurrent{ serial1 }{ serial2 }, "[resource locks @{ $args }] serial tests ran one at a time" );
+        ok( $concurrent{ unlocked }{ lock1 } || $concurrent{ unlocked }{ lock2 },
+            "[resource locks @{ $args }] tests without the lock ran concurrently with locked tests" );
+    }
+
+    return;
+}
+
+# test that parallel tests are started longest first according to the timing database,
+# and that the database is updated
+sub test_timing_db
+{
+    my ($testplan, $unlink) = make_testplan_from_directory( catfile( $TESTDATA_DIR, 'parallel_tests' ) );
+
+    my $dir = File::Temp->newdir( );
+    my $timing_db = catfile( "$dir", 'timings.json' );
+
+    # pass0 is not in the database and should be started first;
+    # the other tests are recorded as taking longer the higher their number.
+    my %tests = map { ("pass$_" => { seconds => $_, runs => 1 }) } (1..9);
+    $tests{ fail1 } = { seconds => 5.5, runs => 1 };
+    IO::File->new( $timing_db, '>' )->print( encode_json( { version => 1, tests => \%tests } ) );
+
+    my $status;
+    my $output = capture_merged {
+        $status = system(
+            $EXECUTABLE_NAME,
+            $TESTSCHEDULER,
+            '--plan',
+            "$testplan",
+            '-j4',
+            '--timing-db',
+            $timing_db,
+            '--debug',
+        );
+    };
+    isnt( $status, 0, '[timing-db] testscheduler fails if some tests fail' );
+
+    my @started = ($output =~ m{spawned [^\n]+\Q[--label] [\E([^\]]+)\]}g);
+    is_deeply( \@started, [qw(pass0 pass9 pass8 pass7 pass6 fail1 pass5 pass4 pass3 pass2 pass1)],
+        '[timing-db] parallel tests started longest first' ) || diag $output;
+
+    my $json = do { local $/; IO::File->new( $timing_db, '<' )->getline( ) };
+    my $recorded = decode_json( $json )->{ tests };
+    is( $recorded->{ pass0 }{ runs }, 1, '[timing-db] new test recorded' );
+    is( $recorded->{ pass9 }{ runs }, 2, '[timing-db] known test updated' );
+    ok( $recorded->{ pass9 }{ seconds } < 9, '[timing-db] duration averaged with this run' );
+
+    return;
+}
+
 sub run
 {
     if (!$QMAKE) {
@@ -411,7 +815,21 @@ sub run
     test_single_pass_no_summary;
     test_mixed;
     test_mixed_parallel_stress;
+    test_mixed_overlap_serial;
+    test_fail_fast;
+    if ($OSNAME !~ m{win32}i) {
+        test_mixed_workers;
+        test_worker_lost;
+        test_no_workers_left;
+
+        # the slow tests fork, and testscheduler stops them by process group
+        test_deadline;
+        test_progress;
+        test_timeout_kill;
+    }
     test_concurrently_limit;
+    test_resource_locks;
+    test_timing_db;
     done_testing;
 
     return;
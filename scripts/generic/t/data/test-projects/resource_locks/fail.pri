@@ -0,0 +1,4 @@
+TEMPLATE=subdirs
+CONFIG += testcase
+check.commands = "$(TESTRUNNER) perl -e \"sleep 1; exit 1\""
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,3 @@
+CONFIG += parallel_test
+testcase.resource_lock = shared_file
+include(../fail.pri)
@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    lock1 \
+    lock2 \
+    serial1 \
+    serial2 \
+    unlocked
@@ -0,0 +1 @@
+include(../fail.pri)
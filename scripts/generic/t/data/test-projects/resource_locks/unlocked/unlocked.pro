@@ -0,0 +1,2 @@
+CONFIG += parallel_test
+include(../fail.pri)
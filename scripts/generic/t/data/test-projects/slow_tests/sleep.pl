@@ -0,0 +1,30 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+
+# A test which doesn't finish by itself: it waits for a child process which
+# sleeps for a long time, so stopping it means stopping its process group.
+# The pid of the child is written to the file named by $SLEEP_PID_FILE.
+#
+# With --stop-testrunner, the testrunner running this test (the leader of the
+# process group testscheduler created for it) is stopped as well, so that it
+# can't enforce the timeout and testscheduler has to kill the test.
+
+my $pid = fork( ) // die "fork: $!";
+if ($pid == 0) {
+    sleep 300;
+    exit 0;
+}
+
+if (my $pid_file = $ENV{ SLEEP_PID_FILE }) {
+    open( my $fh, '>', $pid_file ) || die "open $pid_file: $!";
+    print $fh "$pid\n";
+    close( $fh );
+}
+
+if (@ARGV && $ARGV[0] eq '--stop-testrunner') {
+    kill( 'STOP', getpgrp( ) );
+}
+
+waitpid( $pid, 0 );
+exit 0;
@@ -0,0 +1,4 @@
+TEMPLATE=subdirs
+CONFIG += testcase
+check.commands = $(TESTRUNNER) perl ../sleep.pl
+QMAKE_EXTRA_TARGETS += check
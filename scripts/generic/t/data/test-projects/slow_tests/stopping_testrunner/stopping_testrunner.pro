@@ -0,0 +1,5 @@
+TEMPLATE=subdirs
+CONFIG += testcase
+testcase.timeout = 1
+check.commands = $(TESTRUNNER) perl ../sleep.pl --stop-testrunner
+QMAKE_EXTRA_TARGETS += check
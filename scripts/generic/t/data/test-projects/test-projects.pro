@@ -5,6 +5,10 @@ TEMPLATE=subdirs
 SUBDIRS=\
     tests \
     not_tests \
-    parallel_tests
+    parallel_tests \
+    slow_tests \
+    resource_locks
 
 parallel_tests.CONFIG += no_check_target
+slow_tests.CONFIG += no_check_target
+resource_locks.CONFIG += no_check_target
@@ -45,6 +45,10 @@ testplanner - construct a test plan for a set of testcases
   # Then run them all
   $ testscheduler --timeout 120 -j4 --sync-output --plan testplan.txt
 
+  # Or split them across three machines, using the durations of previous runs
+  $ testplanner --input path/to/tests --output testplan.txt --shards 3 --timing-db timings.json
+  $ testscheduler --timeout 120 -j4 --plan testplan.1.txt --timing-db timings.json
+
 testplanner will iterate through a build tree, collecting information
 about autotests and preparing a test plan to be used by testrunner.
 
@@ -65,6 +69,30 @@ Specifies the output test plan filename.
 Customize the make command to be used for `make check'.
 Defaults to `nmake' on Windows and `make' everywhere else.
 
+=item B<--shards> N
+
+Additionally split the test plan into N shards which are expected to
+take about the same time, for example to run them on N machines.
+Shard I<i> (counting from 0) is written next to the output test plan,
+with the index inserted before the extension (e.g. F<testplan.0.txt>).
+
+Parallel and serial tests are balanced separately, so that the shards
+take about the same time regardless of the number of jobs they are run
+with.  Within each, insignificant tests are spread evenly as well.
+
+=item B<--shard-index> I
+
+Only write shard I (counting from 0) of the N shards given with
+--shards to the output test plan, instead of the complete plan and
+all shards.  Useful when each machine generates its own plan.
+
+=item B<--timing-db> FILENAME
+
+Balance the shards using the test durations recorded in this file by
+`testscheduler --timing-db'.  Tests without a recorded duration are
+assumed to take the average time of the recorded tests.  Without this
+option, each test is assumed to take the same time.
+
 =back
 
 Further options may be passed to the testcases themselves.
@@ -107,6 +135,12 @@ Indicates the test is safe to run in parallel with other tests.
 
 The maximum permitted runtime of the test, in seconds.
 
+=item testcase.resource_lock=I<name> ...
+
+Names of resources the test needs exclusive access to, such as
+a display or a network port.  Tests sharing a name are never run
+concurrently.
+
 =back
 
 
@@ -122,7 +156,8 @@ use File::chdir;
 use Getopt::Long;
 use IO::File;
 use Lingua::EN::Inflect qw(inflect);
-use List::MoreUtils qw(any apply all pairwise each_arrayref);
+use List::MoreUtils qw(any apply all pairwise each_arrayref part);
+use List::Util qw(sum);
 use Pod::Usage;
 use QMake::Project;
 use Readonly;
@@ -130,6 +165,7 @@ use Scalar::Defer qw(force);
 
 use FindBin;
 use lib "$FindBin::Bin/../lib/perl5";
+use QtQA::TestTimings;
 
 use autodie;
 
@@ -156,6 +192,9 @@ sub run
         'output=s' => \$self->{ output },
         'make=s' => \$self->{ make },
         'makefile=s' => \$self->{ makefile },
+        'shards=i' => \$self->{ shards },
+        'shard-index=i' => \$self->{ shard_index },
+        'timing-db=s' => \$self->{ timing_db },
         'testcase' => \$testcase,
     ) || pod2usage(2);
 
@@ -169,6 +208,16 @@ sub run
         $self->{ $arg } || die "Missing mandatory --$arg argument";
     }
 
+    if (defined( $self->{ shards } ) && $self->{ shards } < 1) {
+        die "--shards must be at least 1";
+    }
+    if (defined( $self->{ shard_index } )) {
+        $self->{ shards } || die "--shard-index can only be used with --shards";
+        if ($self->{ shard_index } < 0 || $self->{ shard_index } >= $self->{ shards }) {
+            die "--shard-index must be between 0 and ".($self->{ shards } - 1);
+        }
+    }
+
     # We can't safely handle arguments with spaces.
     # The processing of TESTARGS within the makefile depends on the exact
     # shell being used, which is generally quite difficult to determine
@@ -197,6 +246,10 @@ sub run
     $self->run_make_check( @ARGV );
     $self->finalize_test_plan( $self->{ output } );
 
+    if ($self->{ shards }) {
+        $self->write_shards( $self->{ output } );
+    }
+
     return;
 }
 
@@ -217,6 +270,24 @@ sub finalize_test_plan
         return;
     }
 
+    my @tests = $self->read_test_plan( $filename );
+    my $count = scalar( @tests );
+
+    if ($self->ensure_distinct_labels( \@tests )) {
+        # modified - have to write it back out again.
+        $self->write_test_plan( $filename, @tests );
+    }
+
+    print inflect "Test plan generated for NO(test,$count) at $filename\n";
+
+    return;
+}
+
+# Returns all tests (array of hashrefs) from the test plan in $filename.
+sub read_test_plan
+{
+    my ($self, $filename) = @_;
+
     my @tests;
     my $count = 0;
     my $fh = IO::File->new( $filename, '<' ) || die "open $filename: $!";
@@ -229,18 +300,192 @@ sub finalize_test_plan
         push @tests, $test;
     }
 
-    if ($self->ensure_distinct_labels( \@tests )) {
-        # modified - have to write it back out again.
-        open( my $fh, '>', $filename ) || die "open $filename for truncate: $!";
-        close( $fh ) || die "close $filename after truncate: $!";
-        $self->write_testcase( @tests );
+    return @tests;
+}
+
+# Replaces the test plan in $filename with the given @tests.
+sub write_test_plan
+{
+    my ($self, $filename, @tests) = @_;
+
+    open( my $fh, '>', $filename ) || die "open $filename for truncate: $!";
+    print $fh map { $self->testcase_to_string( $_ )."\n" } @tests;
+    close( $fh ) || die "close $filename after write: $!";
+
+    return;
+}
+
+# Splits the finalized test plan in $filename into the shards requested by
+# --shards, and writes either all of them next to it, or only the one selected
+# by --shard-index in its place.
+sub write_shards
+{
+    my ($self, $filename) = @_;
+
+    my @shards = $self->balanced_shards( $self->{ shards }, $self->read_test_plan( $filename ) );
+
+    my @indexes = (0..$#shards);
+    if (defined( $self->{ shard_index } )) {
+        @indexes = ($self->{ shard_index });
     }
 
-    print inflect "Test plan generated for NO(test,$count) at $filename\n";
+    foreach my $index (@indexes) {
+        my $shard = $shards[ $index ];
+        my $shard_filename = defined( $self->{ shard_index } )
+            ? $filename
+            : $self->shard_filename( $filename, $index );
+        $self->write_test_plan( $shard_filename, @{ $shard->{ tests } } );
+
+        my $count = scalar( @{ $shard->{ tests } } );
+        my $estimate = $self->{ timing_db } ? sprintf( ', estimated %.0f seconds', $shard->{ load } ) : q{};
+        print inflect "Shard $index of $self->{ shards }: NO(test,$count)$estimate at $shard_filename\n";
+    }
 
     return;
 }
 
+# Returns the filename of shard $index of the test plan $filename,
+# e.g. "testplan.2.txt" for "testplan.txt".
+sub shard_filename
+{
+    my ($self, $filename, $index) = @_;
+
+    my ($name, $directory, $extension) = fileparse( $filename, qr{\.[^.]*} );
+
+    return catfile( $directory, "$name.$index$extension" );
+}
+
+# Splits @tests into $count shards with about the same expected duration.
+# Returns a list of $count hashrefs, each with the 'tests' of the shard
+# (arrayref, in the order of @tests) and their total expected duration ('load').
+#
+# Parallel and serial tests are spread evenly over the shards separately, as
+# testscheduler runs them differently.  Within each group, the longest test is
+# repeatedly assigned to the shard with the least work from that group (longest
+# processing time first), with ties going to the shard with the least work
+# overall.  Insignificant tests are assigned before the others, so that they are
+# spread evenly as well and the significant tests make up for any difference.
+# Afterwards, single significant tests are moved or swapped between the shards
+# with the most and the least work from the group for as long as that narrows
+# the gap between them.
+sub balanced_shards
+{
+    my ($self, $count, @tests) = @_;
+
+    my %estimate = $self->estimated_durations( @tests );
+
+    my @load = (0) x $count;
+    my %shard_of_test;
+
+    my @groups = grep { $_ } part { $_->{ parallel_test } ? 1 : 0 } @tests;
+
+    foreach my $group (@groups) {
+        my @group_load = (0) x $count;
+        my @group_tests = map { [] } (1..$count);  # labels of the significant tests
+
+        my @sorted = sort {
+            ($b->{ insignificant_test } ? 1 : 0) <=> ($a->{ insignificant_test } ? 1 : 0)
+                || $estimate{ $b->{ label } } <=> $estimate{ $a->{ label } }
+                || $a->{ label } cmp $b->{ label }
+        } @{ $group };
+
+        foreach my $test (@sorted) {
+            my ($index) = sort {
+                $group_load[ $a ] <=> $group_load[ $b ]
+                    || $load[ $a ] <=> $load[ $b ]
+                    || $a <=> $b
+            } (0..$count-1);
+
+            $group_load[ $index ] += $estimate{ $test->{ label } };
+            $load[ $index ] += $estimate{ $test->{ label } };
+            $shard_of_test{ $test->{ label } } = $index;
+            if (!$test->{ insignificant_test }) {
+                push @{ $group_tests[ $index ] }, $test->{ label };
+            }
+        }
+
+        while (1) {
+            my ($low, $high) = (sort { $group_load[ $a ] <=> $group_load[ $b ] || $a <=> $b } (0..$count-1))[0, -1];
+            my $gap = $group_load[ $high ] - $group_load[ $low ];
+
+            # find the move (undef partner) or swap that leaves the smallest gap
+            my ($best_gap, $best_from, $best_to) = ($gap);
+            foreach my $from (@{ $group_tests[ $high ] }) {
+                foreach my $to (undef, @{ $group_tests[ $low ] }) {
+                    my $delta = $estimate{ $from } - (defined( $to ) ? $estimate{ $to } : 0);
+                    my $new_gap = abs( $gap - 2*$delta );
+                    if ($new_gap < $best_gap - 1e-6) {
+                        ($best_gap, $best_from, $best_to) = ($new_gap, $from, $to);
+                    }
+                }
+            }
+            last unless (defined( $best_from ));
+
+            my $delta = $estimate{ $best_from } - (defined( $best_to ) ? $estimate{ $best_to } : 0);
+            $group_tests[ $high ] = [ grep { $_ ne $best_from } @{ $group_tests[ $high ] } ];
+            push @{ $group_tests[ $low ] }, $best_from;
+            if (defined( $best_to )) {
+                $group_tests[ $low ] = [ grep { $_ ne $best_to } @{ $group_tests[ $low ] } ];
+                push @{ $group_tests[ $high ] }, $best_to;
+            }
+            $group_load[ $high ] -= $delta;
+            $group_load[ $low ] += $delta;
+            $load[ $high ] -= $delta;
+            $load[ $low ] += $delta;
+            $shard_of_test{ $best_from } = $low;
+            if (defined( $best_to )) {
+                $shard_of_test{ $best_to } = $high;
+            }
+        }
+    }
+
+    my @shards = map { { tests => [], load => $load[ $_ ] } } (0..$count-1);
+
+    # keep the tests of each shard in the order of the original plan
+    foreach my $test (@tests) {
+        push @{ $shards[ $shard_of_test{ $test->{ label } } ]{ tests } }, $test;
+    }
+
+    return @shards;
+}
+
+# Returns a hash from the label of each of @tests to its expected duration in
+# seconds, as recorded in the --timing-db.  Tests without a recorded duration
+# get the average of the recorded ones.  Without a --timing-db, all tests
+# get the same duration.
+sub estimated_durations
+{
+    my ($self, @tests) = @_;
+
+    my %estimate;
+    if ($self->{ timing_db }) {
+        my $timings = QtQA::TestTimings->new( $self->{ timing_db } );
+        foreach my $test (@tests) {
+            my $seconds = $timings->estimate( $test->{ label } );
+            if (defined( $seconds )) {
+                $estimate{ $test->{ label } } = $seconds;
+            }
+        }
+    }
+
+    my @known = values %estimate;
+    my $default = @known ? sum( @known ) / @known : 1;
+
+    my $unknown = 0;
+    foreach my $test (@tests) {
+        next if (defined( $estimate{ $test->{ label } } ));
+        $estimate{ $test->{ label } } = $default;
+        ++$unknown;
+    }
+
+    if ($self->{ timing_db } && $unknown) {
+        warn inflect sprintf( "NO(test,$unknown) without recorded duration in %s, assuming %.1f seconds each\n",
+            $self->{ timing_db }, $default );
+    }
+
+    return %estimate;
+}
+
 # Ensures that all tests referred to by $all_tests_ref (arrayref) have a unique
 # label.  Returns 1 if the labels had to be modified in order to achieve this.
 #
@@ -472,6 +717,9 @@ sub plan_testcase
         TARGET
         testcase.timeout
     );
+    my @qmake_list_values = qw(
+        testcase.resource_lock
+    );
     my @qmake_keys = (@qmake_tests, @qmake_scalar_values);
 
     my %info = (
@@ -484,6 +732,14 @@ sub plan_testcase
     # flatten info before passing to Data::Dumper
     @info{ @qmake_keys } = apply { $_ = force $_ } @info{ @qmake_keys };
 
+    # list values are only written if set, to keep the testplan short
+    foreach my $key (@qmake_list_values) {
+        my @values = map { force $_ } $prj->values( $key );
+        if (@values) {
+            $info{ $key } = \@values;
+        }
+    }
+
     # Eliminate any undefined values
     if (my @undefined = grep { !defined( $info{ $_ }) } @qmake_keys) {
         delete @info{ @undefined };
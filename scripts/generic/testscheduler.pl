@@ -62,6 +62,21 @@ Execute tests in parallel, up to N concurrently.
 Note that only tests marked with parallel_test in the testplan
 are permitted to run in parallel.
 
+=item --overlap-serial
+
+Run tests which are not marked with parallel_test alongside the
+parallel tests, instead of one by one after all parallel tests have
+completed.  Only one such test runs at a time, so they remain
+serialized with respect to each other, but no longer with respect
+to parallel tests.  This keeps all jobs busy while the serial tests
+run; it is only appropriate if the tests are not marked parallel_test
+because they conflict with each other rather than with any other test.
+
+Use testcase.resource_lock to serialize tests which conflict with
+particular parallel tests.
+
+Has no effect with -j1.
+
 =item --no-summary
 
 =item --summary
@@ -69,6 +84,49 @@ are permitted to run in parallel.
 Disable/enable printing a summary of test timing, failures, and
 totals at the end of the test run.  Enabled by default.
 
+=item --progress
+
+Report the progress of the test run: a line for each completed test
+with the number of tests completed so far, and a list of the running
+tests every minute while no test completes.
+
+=item --deadline SECONDS
+
+Stop the test run if it has not completed within this many seconds.
+Running tests are killed and remaining tests are not started; the
+test run fails.
+
+=item --fail-fast
+
+Stop the test run as soon as a test fails, unless the test is marked
+with insignificant_test.  Running tests are killed and remaining tests
+are not started.
+
+=item --listen ADDRESS
+
+Run tests on worker processes as well as locally; see L</"DISTRIBUTED TESTING">.
+Workers connect to this address, which is either a host:port to listen on
+for TCP connections, or the path of a Unix domain socket to create.
+
+=item --worker-command COMMAND
+
+Start a worker process by running this shell command, and talk to it
+over its standard input and output; see L</"DISTRIBUTED TESTING">.
+May be given several times.  For example:
+
+  --worker-command "ssh buildhost2 /path/to/testscheduler --connect - -j8"
+
+=item --connect ADDRESS
+
+Run as a worker for the testscheduler listening on this address,
+rather than running a testplan.  ADDRESS is either host:port or the path of a
+Unix domain socket.  If ADDRESS is "-", the worker talks to its testscheduler
+over standard input and output, as used with --worker-command.
+
+The worker runs up to -j tests at a time, and exits when the test run is
+finished.  Any arguments for testrunner given to the worker are used in
+addition to those given to the testscheduler running the testplan.
+
 =item --parallel-stress
 
 Parallel stress testing mode.  This is a special test run mode
@@ -89,6 +147,21 @@ to the test configuration.
 
 Does not run insignificant tests.
 
+=item --timing-db FILENAME
+
+Use the durations of previous test runs stored in this file to
+decide the order of parallel tests, and record the durations of this
+run in it.  The file is created if it does not exist.
+
+Parallel tests are started longest first, so that a slow test
+does not start last and delay the end of the test run while
+the other jobs are idle.  Tests without a recorded duration
+are started before all others, as they might be slow.
+
+The recorded duration of a test is a moving average over its
+runs, so occasional outliers have little effect.  Durations are
+not recorded in parallel stress testing mode.
+
 =item --debug
 
 Output a lot of additional information.  Use it for debugging,
@@ -119,8 +192,52 @@ higher than 1.
 
 Test failures may be ignored if a test is marked with insignificant_test.
 
+=item *
+
+Tests which share a name in their testcase.resource_lock never run
+concurrently, even if they are marked with parallel_test.  This can be
+used for tests which need exclusive access to a resource such as a
+display, a network port or a device.
+
 =back
 
+=head2 DISTRIBUTED TESTING
+
+With --listen or --worker-command, testscheduler acts as a coordinator
+for a number of worker processes, each of which runs tests as instructed
+by the coordinator.  The workers may run on the same host, to run tests
+in separate environments, or on other hosts to spread a test run over
+several machines.
+
+  # on the machine with the testplan
+  $ ./testscheduler --plan testplan.txt -j4 --listen 0.0.0.0:5440
+
+  # on each other machine
+  $ ./testscheduler --connect testhost:5440 -j8
+
+The coordinator hands out tests as workers finish them, so that faster
+workers run more tests.  The coordinator runs up to -j tests itself, and
+passes further tests to workers; use -j0 to run tests only on workers.
+Tests are run in the same order and with the same rules regarding
+parallel_test, insignificant_test and testcase.resource_lock as when
+running locally.
+
+The output of each test is collected by the worker and printed by the
+coordinator when the test completes, as with --sync-output.
+
+The workers must be able to access the build tree under the same path
+as the coordinator, for example by running on the same host or using a
+shared file system.  There is no authentication; anyone able to connect
+to the coordinator can take part in the test run, and workers run
+whatever their coordinator tells them to, so only use this in trusted
+networks.  If a worker is lost while running a test, the test is run
+again on another worker (or locally); if it loses that worker too, it
+fails.  The test run is aborted if no workers are left and there are no
+local jobs or --listen address to run the remaining tests with.
+
+Distributed testing is not available on Windows, and can't be combined
+with --parallel-stress.
+
 =cut
 
 use feature 'switch';
@@ -128,13 +245,23 @@ use feature 'switch';
 use English qw(-no_match_vars);
 use Data::Dumper;
 use File::Spec::Functions;
+use File::Temp;
 use FindBin;
+use lib "$FindBin::Bin/../lib/perl5";
 use IO::File;
+use IO::Socket::INET;
+use IO::Socket::UNIX;
+use JSON::PP;
 use Lingua::EN::Inflect qw(inflect);
-use List::MoreUtils qw(before after_incl any part);
-use List::Util qw(sum max);
+use List::MoreUtils qw(before after_incl any firstidx part);
+use List::Util qw(sum max min);
+use POSIX qw(WNOHANG);
 use Pod::Usage;
+use QtQA::TestTimings;
 use Readonly;
+use Socket qw(AF_UNIX SOCK_STREAM PF_UNSPEC SOMAXCONN);
+use Sys::Hostname;
+use Time::HiRes qw(time);
 use Timer::Simple;
 
 use Getopt::Long qw(
@@ -145,8 +272,32 @@ use Getopt::Long qw(
 # testrunner script
 Readonly my $TESTRUNNER => catfile( $FindBin::Bin, 'testrunner.pl' );
 
+# The following intervals may be overridden in the environment, so that
+# autotests don't have to wait for them.
+
+# seconds between the lists of running tests printed by --progress
+Readonly my $PROGRESS_INTERVAL => $ENV{ QTQA_TESTSCHEDULER_PROGRESS_INTERVAL } // 60;
+
+# seconds a test may run beyond its testcase.timeout before it is killed;
+# normally testrunner enforces the timeout, this is a last resort
+Readonly my $TIMEOUT_GRACE_PERIOD => $ENV{ QTQA_TESTSCHEDULER_TIMEOUT_GRACE_PERIOD } // 60;
+
+# seconds between asking a test to terminate and killing it
+Readonly my $KILL_GRACE_PERIOD => $ENV{ QTQA_TESTSCHEDULER_KILL_GRACE_PERIOD } // 10;
+
+# maximum seconds to wait for a child process to exit before checking timers;
+# only relevant if SIGCHLD is lost somehow
+Readonly my $MAX_WAIT_INTERVAL => 60;
+
+# seconds between checks for exited child processes, on platforms without SIGCHLD
+Readonly my $POLL_INTERVAL => 0.1;
+
+# exit status recorded for a test whose worker disconnected while running it
+Readonly my $WORKER_LOST_STATUS => (255 << 8);
+
 # declarations of static functions
 sub timestr;
+sub kill_test;
 
 sub new
 {
@@ -172,6 +323,14 @@ sub run
         'summary!'  =>  \$self->{ summary },
         'parallel-stress' => \$self->{ parallel_stress },
         'skip-insignificant' => \$self->{ skip_insignificant },
+        'timing-db=s' => \$self->{ timing_db },
+        'overlap-serial' => \$self->{ overlap_serial },
+        'progress' => \$self->{ progress },
+        'deadline=i' => \$self->{ deadline },
+        'fail-fast' => \$self->{ fail_fast },
+        'listen=s' => \$self->{ listen },
+        'worker-command=s@' => \$self->{ worker_commands },
+        'connect=s' => \$self->{ connect },
     ) || pod2usage(2);
 
     # Strip trailing --, if that's what ended our argument processing
@@ -182,6 +341,11 @@ sub run
     # All remaining args are for testrunner
     $self->{ testrunner_args } = [ @args ];
 
+    if (defined( $self->{ connect } )) {
+        $self->run_worker( );
+        return;
+    }
+
     if (!$self->{ testplan }) {
         die "Missing mandatory --plan argument";
     }
@@ -190,10 +354,37 @@ sub run
         die q{error: --parallel-stress mode doesn't make sense with -j1};
     }
 
+    if ($self->{ parallel_stress } && ($self->{ deadline } || $self->{ fail_fast })) {
+        die q{error: --deadline and --fail-fast can't be used in --parallel-stress mode};
+    }
+
+    $self->{ distributed } = $self->{ listen } || @{ $self->{ worker_commands } || [] };
+
+    if ($self->{ distributed } && $OSNAME =~ m{win32}i) {
+        die q{error: distributed testing is not supported on Windows};
+    }
+
+    if ($self->{ distributed } && $self->{ parallel_stress }) {
+        die q{error: --listen and --worker-command can't be used in --parallel-stress mode};
+    }
+
+    if ($self->{ jobs } < 1 && !$self->{ distributed }) {
+        die q{error: -j0 only makes sense with --listen or --worker-command};
+    }
+
+    if ($self->{ timing_db }) {
+        $self->{ timings } = QtQA::TestTimings->new( $self->{ timing_db } );
+    }
+
     my @results = $self->do_testplan( $self->{ testplan } );
 
     $self->debug( sub { 'results: '.Dumper(\@results) } );
 
+    # durations are meaningless if every test ran many times concurrently
+    if ($self->{ timings } && !$self->{ parallel_stress }) {
+        $self->record_timings( @results );
+    }
+
     if ($self->{ summary }) {
         # timing info does not make sense in parallel-stress mode
         if ($self->{ parallel_stress }) {
@@ -217,9 +408,9 @@ sub debug
     return unless $self->{ debug };
 
     my @to_print;
-    if (ref($to_print) == 'CODE') {
+    if (ref($to_print) eq 'CODE') {
         @to_print = $to_print->();
-    } elsif (ref($to_print) == 'ARRAY') {
+    } elsif (ref($to_print) eq 'ARRAY') {
         @to_print = @{$to_print};
     } else {
         @to_print = ($to_print);
@@ -246,9 +437,20 @@ sub do_testplan
     # tests are sorted for predictable execution order.
     @tests = sort { $a->{ label } cmp $b->{ label } } @tests;
 
-    local $SIG{ INT } = sub {
-        die 'aborting due to SIGINT';
-    };
+    local $SIG{ INT } = sub { $self->interrupted( 'SIGINT' ) };
+    local $SIG{ TERM } = sub { $self->interrupted( 'SIGTERM' ) };
+
+    local $SIG{ CHLD } = $SIG{ CHLD };
+    $self->watch_child_exits( );
+
+    $self->{ tests_count } = scalar( @tests );
+    if ($self->{ deadline }) {
+        $self->{ deadline_at } = $self->{ started } + $self->{ deadline };
+    }
+
+    if ($self->{ distributed }) {
+        $self->start_workers( );
+    }
 
     my @out;
 
@@ -258,9 +460,34 @@ sub do_testplan
         @out = $self->execute_tests_from_testplan( @tests );
     }
 
+    if ($self->{ distributed }) {
+        $self->stop_workers( );
+    }
+
     return @out;
 }
 
+# Child processes are reaped without blocking, so the scheduler can react to
+# timers and workers while tests are running.  The SIGCHLD handler installed here
+# wakes up the scheduler when a child exits; see wait_for_event.
+# The caller should localize $SIG{ CHLD }.
+sub watch_child_exits
+{
+    my ($self) = @_;
+
+    if ($OSNAME !~ m{win32}i) {
+        pipe( my $sigchld_reader, my $sigchld_writer ) || die "pipe: $!";
+        $_->blocking( 0 ) for ($sigchld_reader, $sigchld_writer);
+        $self->{ sigchld_reader } = $sigchld_reader;
+        $SIG{ CHLD } = sub { syswrite( $sigchld_writer, 'x' ) };
+    }
+
+    $self->{ started } = time( );
+    $self->{ next_progress_at } = $self->{ started } + $PROGRESS_INTERVAL;
+
+    return;
+}
+
 sub print_failures
 {
     my ($self, @tests) = @_;
@@ -291,7 +518,9 @@ sub print_totals
 {
     my ($self, @tests) = @_;
 
-    my $total = 0;
+    # tests which were not run due to --deadline or --fail-fast count towards the total
+    my $not_run = $self->{ not_run_count } || 0;
+    my $total = $not_run;
     my $pass = 0;
     my $fail = 0;
     my $insignificant_fail = 0;
@@ -314,6 +543,9 @@ sub print_totals
     if ($insignificant_fail) {
         $message .= inflect ", NO(insignificant fail,$insignificant_fail)";
     }
+    if ($not_run) {
+        $message .= ", $not_run not run";
+    }
 
     $message .= ' ';
 
@@ -334,20 +566,26 @@ sub print_timing
         ? $self->{ parallel_timer }->elapsed
         : 0;
 
-    my $serial_total = $self->{ serial_timer }->elapsed;
+    my $serial_total = $self->{ serial_timer }
+        ? $self->{ serial_timer }->elapsed
+        : 0;
     my $total = $parallel_total + $serial_total;
 
+    # With --overlap-serial, serial tests were run concurrently with the parallel tests,
+    # so they count as parallel tests here.
+    my $overlapped = !$self->{ serial_timer };
+
     # This is the time it would have taken to run the parallel tests
     # if they were not actually run in parallel.
     my $parallel_j1_total = sum( map( {
-        ($self->{ jobs } > 1 && $_->{ parallel_test }) ? $_->{ _timer }->elapsed : 0
+        ($self->runs_concurrently( ) && ($_->{ parallel_test } || $overlapped)) ? $_->{ _timer }->elapsed : 0
     } @tests )) || 0;
 
     # This fudge factor adjusts for the fact that some tests would be able
     # to run faster if they were the only test running.
     # Another way of thinking of this is: by running tests in parallel, we
     # assume we've slowed down individual tests by about 10%.
-    if ($self->{ jobs } > 1) {
+    if ($self->runs_concurrently( )) {
         $parallel_j1_total *= 0.9;
     }
 
@@ -364,7 +602,21 @@ sub print_timing
 
     my $parallel_speedup = $parallel_j1_total - $parallel_total;
 
-    if ($parallel_total) {
+    if ($overlapped) {
+
+        printf( <<'EOF',
+=== Timing: =================== TEST RUN COMPLETED! ============================
+  Total:                                       %s
+  Estimated time spent on insignificant tests: %s
+  Estimated time saved by -j%d:                 %s
+EOF
+            timestr( $total ),
+            timestr( $insignificant_total ),
+            $self->total_jobs( ),
+            timestr( $parallel_speedup ),
+        );
+
+    } elsif ($parallel_total) {
 
         printf( <<'EOF',
 === Timing: =================== TEST RUN COMPLETED! ============================
@@ -378,7 +630,7 @@ EOF
             timestr( $serial_total ),
             timestr( $parallel_total ),
             timestr( $insignificant_total ),
-            $self->{ jobs },
+            $self->total_jobs( ),
             timestr( $parallel_speedup ),
         );
 
@@ -477,7 +729,7 @@ sub execute_tests_from_testplan
 {
     my ($self, @tests) = @_;
 
-    my $jobs = $self->{ jobs };
+    my $concurrent = $self->runs_concurrently( );
 
     # Results will be recorded here.
     # Each element is equal to an input element from @tests with additional keys added.
@@ -493,12 +745,13 @@ sub execute_tests_from_testplan
     #
     $self->{ test_results } = [];
 
-    # Do all the parallel tests first, then serial.
+    # Do all the parallel tests first, then serial, unless serial tests may overlap
+    # with parallel tests.
     # However, if jobs are 1, all tests are serial.
     my @parallel_tests;
     my @serial_tests;
     foreach my $test (@tests) {
-        if ($test->{ parallel_test } && $jobs > 1) {
+        if ($test->{ parallel_test } && $concurrent) {
             push @parallel_tests, $test;
         }
         else {
@@ -506,6 +759,19 @@ sub execute_tests_from_testplan
         }
     }
 
+    if ($self->{ overlap_serial } && $concurrent) {
+        # Serial tests are the longest chain of tests which can't overlap,
+        # so start them as early as possible.
+        $self->{ parallel_timer } = Timer::Simple->new( );
+        $self->execute_parallel_tests(
+            $self->sort_longest_first( @serial_tests ),
+            $self->sort_longest_first( @parallel_tests ),
+        );
+        $self->{ parallel_timer }->stop( );
+
+        return $self->checked_test_results( @tests );
+    }
+
     # If there is only one parallel test, downgrade it to a serial test
     if (@parallel_tests == 1) {
         @serial_tests = (@parallel_tests, @serial_tests);
@@ -513,12 +779,13 @@ sub execute_tests_from_testplan
     }
 
     if (@parallel_tests) {
+        @parallel_tests = $self->sort_longest_first( @parallel_tests );
         $self->{ parallel_timer } = Timer::Simple->new( );
         $self->execute_parallel_tests( @parallel_tests );
         $self->{ parallel_timer }->stop( );
     }
 
-    if (@parallel_tests && @serial_tests) {
+    if (@parallel_tests && @serial_tests && !$self->{ aborted }) {
         my $p = scalar( @parallel_tests );
         my $s = scalar( @serial_tests );
         # NO -> Number Of
@@ -529,10 +796,36 @@ sub execute_tests_from_testplan
     $self->execute_serial_tests( @serial_tests );
     $self->{ serial_timer }->stop( );
 
+    return $self->checked_test_results( @tests );
+}
+
+# Returns true if more than one test may run at a time.
+sub runs_concurrently
+{
+    my ($self) = @_;
+
+    return $self->{ jobs } > 1 || $self->{ distributed };
+}
+
+# Returns the number of tests which could run at a time, including those on workers.
+sub total_jobs
+{
+    my ($self) = @_;
+
+    return sum( $self->{ jobs }, map { $_->{ jobs } } @{ $self->{ workers } || [] } );
+}
+
+# Returns the results of all tests run, after checking that each of @tests has been run.
+sub checked_test_results
+{
+    my ($self, @tests) = @_;
+
     my @test_results = @{ $self->{ test_results } };
 
     # Sanity check
-    if (scalar(@test_results) != scalar(@tests)) {
+    if ($self->{ aborted }) {
+        $self->{ not_run_count } = scalar(@tests) - scalar(@test_results);
+    } elsif (scalar(@test_results) != scalar(@tests)) {
         die 'internal error: I expected to run '.scalar(@tests).' tests, but only '
            .scalar(@test_results).' tests reported results';
     }
@@ -540,6 +833,53 @@ sub execute_tests_from_testplan
     return @test_results;
 }
 
+# Returns @tests ordered by their expected duration from the timing database,
+# longest first.  Tests which are not in the database are expected to be the longest.
+# Without a timing database, @tests are returned unchanged.
+sub sort_longest_first
+{
+    my ($self, @tests) = @_;
+
+    my $timings = $self->{ timings } || return @tests;
+
+    my %estimate = map {
+        $_->{ label } => $timings->estimate( $_->{ label } ) // 9**9**9
+    } @tests;
+
+    @tests = sort {
+        $estimate{ $b->{ label } } <=> $estimate{ $a->{ label } }
+            || $a->{ label } cmp $b->{ label }
+    } @tests;
+
+    $self->debug( sub { 'parallel tests by expected duration: '.join(', ', map { $_->{ label } } @tests) } );
+
+    return @tests;
+}
+
+# Adds the runtime of all @tests to the timing database and saves it.
+sub record_timings
+{
+    my ($self, @tests) = @_;
+
+    # the durations of a test run stopped by --deadline or --fail-fast are
+    # incomplete, and so are those of tests which were terminated or killed
+    return if $self->{ aborted };
+
+    my $timings = $self->{ timings };
+
+    foreach my $test (@tests) {
+        next if ($test->{ _terminated_at } || $test->{ _killed } || $test->{ _worker_lost });
+        $timings->record( $test->{ label }, $test->{ _timer }->elapsed );
+    }
+
+    eval { $timings->save( ) };
+    if (my $error = $@) {
+        warn __PACKAGE__ . ": could not save timing database: $error";
+    }
+
+    return;
+}
+
 # Do parallel stress test.
 # Compared to normal execution, the following additional result keys are
 # associated with each test:
@@ -616,15 +956,60 @@ sub execute_parallel_stress
     return @tests;
 }
 
+# Returns the names of the resources the $test needs exclusive access to.
+# Tests which are not parallel-safe need exclusive access among themselves.
+sub resource_locks
+{
+    my ($self, $test) = @_;
+
+    my $locks = $test->{ 'testcase.resource_lock' } || [];
+    my @out = ref($locks) ? @{ $locks } : split( /\s+/, $locks );
+
+    if (!$test->{ parallel_test }) {
+        push @out, '(serial)';
+    }
+
+    return @out;
+}
+
+# Returns true if none of the resources needed by $test are held by a running test.
+sub resources_available
+{
+    my ($self, $test) = @_;
+
+    my %held = map { $_ => 1 } map { $self->resource_locks( $_ ) } values %{ $self->{ test_by_pid } || {} };
+
+    return !any { $held{ $_ } } $self->resource_locks( $test );
+}
+
+# Runs @tests concurrently, up to the number of jobs (and free worker jobs) at a time.
+# Tests are started in the given order, except that a test waits while
+# another test holds one of its resource locks; meanwhile, later tests
+# may be started.
 sub execute_parallel_tests
 {
     my ($self, @tests) = @_;
     return unless @tests;
 
-    while (my $test = shift @tests) {
-        while ($self->running_tests_count() >= $self->{ jobs }) {
+    while (1) {
+        # tests whose worker was lost go first, as they were started before the others
+        unshift @tests, $self->take_requeued_tests( );
+        if (!@tests) {
+            last unless $self->running_tests_count( );
+            $self->wait_for_test_to_complete( );
+            next;
+        }
+
+        $self->wait_for_free_slot( );
+        last if $self->{ aborted };
+
+        my $index = firstidx { $self->resources_available( $_ ) } @tests;
+        if ($index < 0) {
             $self->wait_for_test_to_complete( );
+            next;
         }
+
+        my ($test) = splice( @tests, $index, 1 );
         $self->spawn_subtest(
             test => $test,
             testrunner_args => [ '--sync-output' ],
@@ -644,10 +1029,14 @@ sub execute_serial_tests
 
     return unless @tests;
 
-    while (my $test = shift @tests) {
+    while (1) {
         while ($self->running_tests_count()) {
             $self->wait_for_test_to_complete( );
         }
+        unshift @tests, $self->take_requeued_tests( );
+        my $test = shift( @tests ) || last;
+        $self->wait_for_free_slot( );
+        last if $self->{ aborted };
         $self->spawn_subtest( test => $test );
     }
 
@@ -697,6 +1086,29 @@ sub spawn_subtest
 
     my $test = $args{ test };
 
+    # Tests are run locally while there are free local jobs, then on workers.
+    my $worker = ($self->local_tests_count( ) < $self->{ jobs }) ? undef : $self->free_worker( );
+
+    $test->{ _timer } = Timer::Simple->new( );
+    $test->{ _started_at } = time( );
+
+    # Save a reference to all tests running at the time this test began,
+    # and also associate this test we've started with all other currently running tests
+    $test->{ _parallel_tests } = [];
+    foreach my $other_pid (keys %{ $self->{ test_by_pid } || {} }) {
+        my $other_test = $self->{ test_by_pid }{ $other_pid };
+        push @{ $test->{ _parallel_tests } }, $other_test;
+        push @{ $other_test->{ _parallel_tests } }, $test;
+    }
+
+    if ($worker) {
+        $self->dispatch_to_worker( $worker, $test, [
+            @{ $args{ testrunner_args } || []},
+            @{ $self->{ testrunner_args } || []},
+        ] );
+        return;
+    }
+
     my @testrunner_args = (
         '--chdir',
         $test->{ cwd },
@@ -715,18 +1127,8 @@ sub spawn_subtest
     );
 
     my @cmd = (@testrunner_cmd, '--', @cmd_and_args );
-    $test->{ _timer } = Timer::Simple->new( );
 
-    # Save a reference to all tests running at the time this test began,
-    # and also associate this test we've started with all other currently running tests
-    $test->{ _parallel_tests } = [];
-    foreach my $other_pid (keys %{ $self->{ test_by_pid } || {} }) {
-        my $other_test = $self->{ test_by_pid }{ $other_pid };
-        push @{ $test->{ _parallel_tests } }, $other_test;
-        push @{ $other_test->{ _parallel_tests } }, $test;
-    }
-
-    my $pid = $self->spawn( @cmd );
+    my $pid = $self->spawn( { output => $args{ output } }, @cmd );
     $self->{ test_by_pid }{ $pid } = $test;
 
     return;
@@ -743,23 +1145,112 @@ sub running_tests_count
     return $out;
 }
 
+# Returns the number of tests running as child processes of this process.
+sub local_tests_count
+{
+    my ($self) = @_;
+
+    return scalar grep { !$_->{ _worker } } values %{ $self->{ test_by_pid } || {} };
+}
+
+# Returns true if tests can still be run: locally, on a connected worker or
+# one starting up, or on workers yet to connect to our listener.
+sub workers_left
+{
+    my ($self) = @_;
+
+    return $self->{ jobs } || $self->{ listener }
+        || any { !$_->{ closed } } @{ $self->{ workers } || [] };
+}
+
+# Returns the tests to run again because their worker was lost, and forgets them.
+sub take_requeued_tests
+{
+    my ($self) = @_;
+
+    return splice( @{ $self->{ requeued_tests } || [] } );
+}
+
+# Returns true if another test can be started now, locally or on a worker.
+sub free_slot
+{
+    my ($self) = @_;
+
+    return $self->local_tests_count( ) < $self->{ jobs } || $self->free_worker( );
+}
+
+# Waits until another test can be started, or the test run is aborted.
+sub wait_for_free_slot
+{
+    my ($self) = @_;
+
+    until ($self->{ aborted } || $self->free_slot( )) {
+        next if $self->collect_completed_test( );
+        if (!$self->workers_left( )) {
+            $self->abort( 'no workers left to run tests' );
+            last;
+        }
+        $self->handle_timers( );
+        $self->wait_for_event( );
+    }
+
+    return;
+}
+
 # Waits for one test to complete and writes the '_status' key for that test.
-# The exit status is returned.
+# The exit status is returned.  Returns undef if a test has to be run again
+# because its worker was lost.
+# While waiting, timers for progress reports and deadlines are handled.
 sub wait_for_test_to_complete
 {
-    my ($self, $flags) = @_;
+    my ($self) = @_;
+
+    while ($self->running_tests_count( ) && !@{ $self->{ requeued_tests } || [] }) {
+        if (my $test = $self->collect_completed_test( )) {
+            return $test->{ _status };
+        }
+        $self->handle_timers( );
+        $self->wait_for_event( );
+    }
+
+    return;
+}
+
+# If a test has completed, locally or on a worker, records its result and returns it.
+# Returns undef without waiting if no test has completed.
+sub collect_completed_test
+{
+    my ($self) = @_;
+
+    if (my $completed = shift @{ $self->{ completed_remote_tests } || [] }) {
+        return $self->complete_test( @{ $completed } );
+    }
 
-    return if (!$self->running_tests_count( ));
+    while (1) {
+        my $pid = waitpid( -1, WNOHANG );
+        my $status = $?;
 
-    my $pid = waitpid( -1, $flags || 0 );
-    my $status = $?;
+        # none exited, or no child processes
+        return if ($pid <= 0);
 
-    $self->debug( sprintf( "waitpid: (pid: %d, status: %d, exitcode: %d)", $pid, $status, $status >> 8) );
+        $self->debug( sprintf( "waitpid: (pid: %d, status: %d, exitcode: %d)", $pid, $status, $status >> 8) );
 
-    if ($pid <= 0) {
-        # this means no child processes
-        return;
+        if (my $command = delete $self->{ worker_pids }{ $pid }) {
+            $self->debug( "worker command exited: $command" );
+            next;
+        }
+
+        if (my $test = $self->complete_test( $pid, $status )) {
+            return $test;
+        }
     }
+}
+
+# Records that the test running as $pid (or under this key, on a worker) completed
+# with the given exit $status.  Returns the test.
+sub complete_test
+{
+    my ($self, $pid, $status) = @_;
 
     my $test = delete $self->{ test_by_pid }{ $pid };
     if (!$test) {
@@ -767,15 +1258,600 @@ sub wait_for_test_to_complete
         return;
     }
 
+    if (my $worker = $test->{ _worker }) {
+        --$worker->{ running };
+    }
+
     $test->{ _timer }->stop( );
     $test->{ _status } = $status;
     $test->{ _parallel_count } = $self->running_tests_count( );
 
+    push @{ $self->{ test_results } }, $test;
+
     $self->print_test_fail_info( $test );
+    $self->print_test_progress( $test );
 
-    push @{ $self->{ test_results } }, $test;
+    if ($self->{ fail_fast } && $status && !$test->{ insignificant_test } && !$self->{ aborted }) {
+        $self->abort( "$test->{ label } failed and --fail-fast was given" );
+    }
 
-    return $status;
+    return $test;
+}
+
+# Waits until a child process may have exited, or the next timer is due.
+sub wait_for_event
+{
+    my ($self) = @_;
+
+    my $now = time( );
+    my @due = grep { defined($_) } (
+        $self->{ deadline_at },
+        ($self->{ progress } ? $self->{ next_progress_at } : undef),
+        map( { $self->test_kill_time( $_ ) } values %{ $self->{ test_by_pid } } ),
+    );
+    my $timeout = min( $MAX_WAIT_INTERVAL, map { $_ - $now } @due );
+    $timeout = max( $timeout, 0 );
+
+    my $reader = $self->{ sigchld_reader };
+    if (!$reader) {
+        # no SIGCHLD on this platform; just poll
+        select( undef, undef, undef, min( $timeout, $POLL_INTERVAL ) );
+        return;
+    }
+
+    my $watched = q{};
+    foreach my $handle ($reader, map { $_->{ handle } } values %{ $self->{ watchers } || {} }) {
+        vec( $watched, fileno( $handle ), 1 ) = 1;
+    }
+
+    my $readable = $watched;
+    if (select( $readable, undef, undef, $timeout ) <= 0) {
+        return;
+    }
+
+    if (vec( $readable, fileno( $reader ), 1 )) {
+        # drain the pipe; any number of children may have exited since the last time
+        1 while (sysread( $reader, my $buf, 512 ));
+    }
+
+    foreach my $fileno (keys %{ $self->{ watchers } || {} }) {
+        # a callback may have removed other watchers
+        my $watcher = $self->{ watchers }{ $fileno } || next;
+        if (vec( $readable, $fileno, 1 )) {
+            $watcher->{ callback }->( );
+        }
+    }
+
+    return;
+}
+
+# Adds a channel for messages to or from another testscheduler, reading from the $in
+# handle and writing to the $out handle.  Messages are hashes, sent as one line of JSON
+# each.  $on_message is called for each received message with the channel and the message,
+# and $on_close is called with the channel when it is closed by the other side.
+sub add_channel
+{
+    my ($self, $in, $out, $on_message, $on_close) = @_;
+
+    $out->autoflush( 1 );
+
+    my $channel = {
+        in => $in,
+        out => $out,
+        buffer => q{},
+    };
+
+    $self->{ watchers }{ fileno( $in ) } = {
+        handle => $in,
+        callback => sub { $self->read_channel( $channel, $on_message, $on_close ) },
+    };
+
+    return $channel;
+}
+
+sub read_channel
+{
+    my ($self, $channel, $on_message, $on_close) = @_;
+
+    my $read = sysread( $channel->{ in }, $channel->{ buffer }, 65536, length( $channel->{ buffer } ) );
+    if (!defined( $read ) && $!{ EINTR }) {
+        return;
+    }
+
+    if (!$read) {
+        $self->close_channel( $channel );
+        $on_close->( $channel );
+        return;
+    }
+
+    while ($channel->{ buffer } =~ s{\A([^\n]*)\n}{}) {
+        my $line = $1;
+        my $message = eval { decode_json( $line ) };
+        if (ref( $message ) ne 'HASH') {
+            warn __PACKAGE__ . ": ignoring invalid message: $line\n";
+            next;
+        }
+        $self->debug( "received: $line" );
+        $on_message->( $channel, $message );
+    }
+
+    return;
+}
+
+sub send_message
+{
+    my ($self, $channel, $message) = @_;
+
+    return if $channel->{ closed };
+
+    my $line = encode_json( $message );
+    $self->debug( "sending: $line" );
+
+    my $out = $channel->{ out };
+    if (!print {$out} "$line\n") {
+        warn __PACKAGE__ . ": failed to send message: $!\n";
+    }
+
+    return;
+}
+
+sub close_channel
+{
+    my ($self, $channel) = @_;
+
+    return if $channel->{ closed };
+
+    delete $self->{ watchers }{ fileno( $channel->{ in } ) };
+    close( $channel->{ in } );
+    close( $channel->{ out } );
+    $channel->{ closed } = 1;
+
+    return;
+}
+
+# Starts listening for workers, and starts the worker commands.
+sub start_workers
+{
+    my ($self) = @_;
+
+    if (my $address = $self->{ listen }) {
+        my $listener;
+        if ($address =~ m{/}) {
+            # a stale socket from an earlier run would prevent us from listening
+            unlink( $address ) if (-S $address);
+            $listener = IO::Socket::UNIX->new(
+                Type => SOCK_STREAM,
+                Local => $address,
+                Listen => SOMAXCONN,
+            ) || die "listen on $address: $!";
+            $self->{ socket_path } = $address;
+        } else {
+            $listener = IO::Socket::INET->new(
+                LocalAddr => $address,
+                Listen => SOMAXCONN,
+                ReuseAddr => 1,
+            ) || die "listen on $address: $@";
+        }
+
+        $self->{ listener } = $listener;
+        $self->{ watchers }{ fileno( $listener ) } = {
+            handle => $listener,
+            callback => sub {
+                my $socket = $listener->accept( ) || return;
+                $self->add_worker( $socket, $socket );
+            },
+        };
+
+        $self->print_info( "waiting for workers on $address\n" );
+    }
+
+    foreach my $command (@{ $self->{ worker_commands } || [] }) {
+        socketpair( my $socket, my $worker_socket, AF_UNIX, SOCK_STREAM, PF_UNSPEC )
+            || die "socketpair: $!";
+
+        my $pid = fork();
+        if (!defined( $pid )) {
+            die "fork: $!";
+        }
+        if ($pid == 0) {
+            close( $socket );
+            open( STDIN, '<&', $worker_socket ) || die "dup: $!";
+            open( STDOUT, '>&', $worker_socket ) || die "dup: $!";
+            exec( '/bin/sh', '-c', $command );
+            die "exec: $!";
+        }
+
+        close( $worker_socket );
+        $self->{ worker_pids }{ $pid } = $command;
+        $self->add_worker( $socket, $socket );
+    }
+
+    return;
+}
+
+sub add_worker
+{
+    my ($self, $in, $out) = @_;
+
+    my $worker = $self->add_channel(
+        $in,
+        $out,
+        sub { $self->on_worker_message( @_ ) },
+        sub { $self->on_worker_closed( @_ ) },
+    );
+
+    $worker->{ id } = ++$self->{ workers_count };
+    $worker->{ name } = "worker $worker->{ id }";
+
+    # the worker says how many tests it can run when it is ready
+    $worker->{ jobs } = 0;
+    $worker->{ running } = 0;
+
+    push @{ $self->{ workers } }, $worker;
+
+    return;
+}
+
+# Returns the connected worker able to run another test with the fewest tests
+# running per job, or undef if all workers are busy.
+sub free_worker
+{
+    my ($self) = @_;
+
+    my @free = grep {
+        !$_->{ closed } && $_->{ running } < $_->{ jobs }
+    } @{ $self->{ workers } || [] };
+
+    my ($out) = sort { $a->{ running }/$a->{ jobs } <=> $b->{ running }/$b->{ jobs } } @free;
+
+    return $out;
+}
+
+sub dispatch_to_worker
+{
+    my ($self, $worker, $test, $testrunner_args) = @_;
+
+    my $id = ++$self->{ remote_tests_count };
+
+    # keys starting with '_' are our own, not from the testplan
+    my %testplan_test = map { $_ => $test->{ $_ } } grep { !m{\A_} } keys %{ $test };
+
+    $self->send_message( $worker, {
+        type => 'test',
+        id => $id,
+        test => \%testplan_test,
+        testrunner_args => $testrunner_args,
+    } );
+
+    $test->{ _worker } = $worker;
+    $test->{ _remote_id } = $id;
+    ++$worker->{ running };
+
+    $self->{ test_by_pid }{ "$worker->{ name }/$id" } = $test;
+
+    return;
+}
+
+sub on_worker_message
+{
+    my ($self, $worker, $message) = @_;
+
+    my $type = $message->{ type } // q{};
+
+    if ($type eq 'hello') {
+        $worker->{ jobs } = int( $message->{ jobs } || 0 );
+        $self->print_info( inflect "$worker->{ name } connected from $message->{ host }, "
+            ."running up to NO(test,$worker->{ jobs }) at a time\n" );
+    } elsif ($type eq 'result') {
+        my $key = "$worker->{ name }/$message->{ id }";
+        if (!$self->{ test_by_pid }{ $key }) {
+            warn __PACKAGE__ . ": $worker->{ name } sent a result for unknown test $message->{ id }\n";
+            return;
+        }
+
+        local $| = 1;
+        print $message->{ output } // q{};
+
+        push @{ $self->{ completed_remote_tests } }, [ $key, $message->{ status } ];
+    } else {
+        warn __PACKAGE__ . ": $worker->{ name }: ignoring unknown message type '$type'\n";
+    }
+
+    return;
+}
+
+sub on_worker_closed
+{
+    my ($self, $worker) = @_;
+
+    $self->print_info( "$worker->{ name } disconnected\n" );
+
+    foreach my $key (keys %{ $self->{ test_by_pid } }) {
+        my $test = $self->{ test_by_pid }{ $key };
+        next unless ($test->{ _worker } && $test->{ _worker } == $worker);
+
+        # A test is run once more on another worker, as the worker may have been
+        # lost for reasons unrelated to the test; a test which loses its worker
+        # twice probably made it crash.
+        if (!$test->{ _requeued } && !$test->{ _terminated_at } && !$self->{ aborted }) {
+            $self->print_info( "$test->{ label }: lost $worker->{ name } while running this test; running it again\n" );
+            delete $self->{ test_by_pid }{ $key };
+            delete @{ $test }{ qw(_worker _remote_id) };
+            $test->{ _requeued } = 1;
+            push @{ $self->{ requeued_tests } }, $test;
+            next;
+        }
+
+        $self->print_info( "$test->{ label }: lost $worker->{ name } while running this test\n" );
+        $test->{ _worker_lost } = 1;
+        push @{ $self->{ completed_remote_tests } }, [ $key, $WORKER_LOST_STATUS ];
+    }
+
+    return;
+}
+
+# Tells all workers that the test run is finished, and stops listening for more workers.
+sub stop_workers
+{
+    my ($self) = @_;
+
+    if (my $listener = delete $self->{ listener }) {
+        delete $self->{ watchers }{ fileno( $listener ) };
+        close( $listener );
+        if (my $path = delete $self->{ socket_path }) {
+            unlink( $path );
+        }
+    }
+
+    foreach my $worker (@{ $self->{ workers } || [] }) {
+        $self->send_message( $worker, { type => 'done' } );
+        $self->close_channel( $worker );
+    }
+
+    return;
+}
+
+# Runs as a worker: connects to the testscheduler at $self->{ connect } and runs the tests
+# it sends, until it says that the test run is finished.
+sub run_worker
+{
+    my ($self) = @_;
+
+    if ($OSNAME =~ m{win32}i) {
+        die q{error: distributed testing is not supported on Windows};
+    }
+
+    my $address = $self->{ connect };
+    my ($in, $out);
+
+    if ($address eq '-') {
+        # stdout is our channel to the coordinator, so anything else we print goes to stderr
+        $in = \*STDIN;
+        open( $out, '>&', \*STDOUT ) || die "dup STDOUT: $!";
+        open( STDOUT, '>&', \*STDERR ) || die "dup STDERR: $!";
+    } elsif ($address =~ m{/}) {
+        $in = $out = IO::Socket::UNIX->new( Type => SOCK_STREAM, Peer => $address )
+            || die "connect to $address: $!";
+    } else {
+        $in = $out = IO::Socket::INET->new( PeerAddr => $address )
+            || die "connect to $address: $@";
+    }
+
+    local $SIG{ INT } = sub { $self->interrupted( 'SIGINT' ) };
+    local $SIG{ TERM } = sub { $self->interrupted( 'SIGTERM' ) };
+    local $SIG{ CHLD } = $SIG{ CHLD };
+    $self->watch_child_exits( );
+
+    my $coordinator = $self->add_channel(
+        $in,
+        $out,
+        sub { $self->on_coordinator_message( @_ ) },
+        sub {
+            if ($self->running_tests_count( )) {
+                $self->abort( 'lost connection to testscheduler' );
+            }
+        },
+    );
+
+    $self->send_message( $coordinator, { type => 'hello', jobs => $self->{ jobs }, host => hostname( ) } );
+
+    while ((!$coordinator->{ closed } && !$self->{ worker_done }) || $self->running_tests_count( )) {
+        if (my $test = $self->collect_completed_test( )) {
+            my $output_file = delete $test->{ _output };
+            my $output = do { local $/; my $fh = IO::File->new( "$output_file", '<' ); $fh ? <$fh> : q{} };
+            $self->send_message( $coordinator, {
+                type => 'result',
+                id => $test->{ _remote_id },
+                status => $test->{ _status },
+                output => $output,
+            } );
+            next;
+        }
+        $self->handle_timers( );
+        $self->wait_for_event( );
+    }
+
+    $self->close_channel( $coordinator );
+
+    return;
+}
+
+sub on_coordinator_message
+{
+    my ($self, $coordinator, $message) = @_;
+
+    my $type = $message->{ type } // q{};
+
+    if ($type eq 'test') {
+        my $test = $message->{ test };
+        $test->{ _remote_id } = $message->{ id };
+        $test->{ _output } = File::Temp->new( TEMPLATE => 'qtqa-testscheduler-XXXXXX', TMPDIR => 1 );
+        $self->spawn_subtest(
+            test => $test,
+            testrunner_args => [ '--sync-output', @{ $message->{ testrunner_args } || [] } ],
+            output => "$test->{ _output }",
+        );
+    } elsif ($type eq 'terminate') {
+        foreach my $pid (keys %{ $self->{ test_by_pid } }) {
+            if ($self->{ test_by_pid }{ $pid }{ _remote_id } == $message->{ id }) {
+                $self->terminate_test( $pid );
+            }
+        }
+    } elsif ($type eq 'done') {
+        $self->{ worker_done } = 1;
+    } else {
+        warn __PACKAGE__ . ": ignoring unknown message type '$type'\n";
+    }
+
+    return;
+}
+
+# Returns the time at which the given running $test should be killed, or undef.
+# Tests which have been asked to terminate are killed for good after a grace period.
+# Tests which greatly exceed their testcase.timeout are also killed, in case testrunner
+# failed to stop them.
+sub test_kill_time
+{
+    my ($self, $test) = @_;
+
+    # workers enforce timeouts of their tests themselves
+    return if ($test->{ _killed } || $test->{ _worker });
+
+    if ($test->{ _terminated_at }) {
+        return $test->{ _terminated_at } + $KILL_GRACE_PERIOD;
+    }
+
+    my $timeout = $test->{ 'testcase.timeout' };
+    if ($timeout && $timeout =~ m{\A [0-9]+ \z}xms) {
+        return $test->{ _started_at } + $timeout + $TIMEOUT_GRACE_PERIOD;
+    }
+
+    return;
+}
+
+# Handles all timers which are due: the global deadline, tests which exceeded their
+# time budget, and progress reports.
+sub handle_timers
+{
+    my ($self) = @_;
+
+    my $now = time( );
+
+    if ($self->{ deadline_at } && $now >= $self->{ deadline_at } && !$self->{ aborted }) {
+        $self->abort( 'deadline of '.timestr( $self->{ deadline } ).' exceeded' );
+    }
+
+    foreach my $pid (keys %{ $self->{ test_by_pid } }) {
+        my $test = $self->{ test_by_pid }{ $pid };
+        my $kill_time = $self->test_kill_time( $test );
+        next unless (defined( $kill_time ) && $now >= $kill_time);
+
+        if ($test->{ _terminated_at }) {
+            $self->debug( "$test->{ label } did not terminate, killing it" );
+            kill_test( 'KILL', $pid );
+            delete $test->{ _terminated_at };
+            $test->{ _killed } = 1;
+        } else {
+            $self->print_info( "$test->{ label } is still running "
+                .timestr( $now - $test->{ _started_at } )
+                .' after its timeout of '.timestr( $test->{ 'testcase.timeout' } )."; killing it\n" );
+            $self->terminate_test( $pid );
+        }
+    }
+
+    if ($self->{ progress } && $now >= $self->{ next_progress_at }) {
+        $self->print_running_tests( );
+        $self->{ next_progress_at } = $now + $PROGRESS_INTERVAL;
+    }
+
+    return;
+}
+
+# Asks the test running as $pid to terminate.
+sub terminate_test
+{
+    my ($self, $pid) = @_;
+
+    my $test = $self->{ test_by_pid }{ $pid };
+    $test->{ _terminated_at } = time( );
+
+    if (my $worker = $test->{ _worker }) {
+        $self->send_message( $worker, { type => 'terminate', id => $test->{ _remote_id } } );
+        return;
+    }
+
+    kill_test( 'TERM', $pid );
+
+    return;
+}
+
+# Handles a signal which stops the scheduler.  The tests run in process groups
+# of their own and don't get the signal from the terminal, so they are asked to
+# terminate here.
+sub interrupted
+{
+    my ($self, $signal) = @_;
+
+    foreach my $pid (keys %{ $self->{ test_by_pid } || {} }) {
+        next if ($self->{ test_by_pid }{ $pid }{ _worker });
+        kill_test( 'TERM', $pid );
+    }
+
+    die "aborting due to $signal";
+}
+
+# Stops the test run: running tests are terminated, and no more tests are started.
+sub abort
+{
+    my ($self, $reason) = @_;
+
+    $self->{ aborted } = $reason;
+
+    my @pids = keys %{ $self->{ test_by_pid } || {} };
+    $self->print_info( inflect "aborting: $reason; stopping NO(running test,".scalar(@pids).")\n" );
+
+    foreach my $pid (@pids) {
+        $self->terminate_test( $pid );
+    }
+
+    return;
+}
+
+# With --progress, reports that $test has completed.
+sub print_test_progress
+{
+    my ($self, $test) = @_;
+
+    return unless $self->{ progress };
+
+    # in parallel-stress mode, each test runs many times
+    return if $self->{ parallel_stress };
+
+    my $done = scalar( @{ $self->{ test_results } } );
+    my $result = $test->{ _status } ? 'failed' : 'passed';
+    $self->print_info( "progress: [$done/$self->{ tests_count }] $test->{ label } $result ("
+        .timestr( $test->{ _timer }->elapsed ).')'
+        .inflect( ", NO(test,".$self->running_tests_count( ).") running\n" ) );
+
+    # a completed test is progress enough; postpone the next list of running tests
+    $self->{ next_progress_at } = time( ) + $PROGRESS_INTERVAL;
+
+    return;
+}
+
+# With --progress, lists the running tests, longest running first.
+sub print_running_tests
+{
+    my ($self) = @_;
+
+    my $now = time( );
+    my @running = sort { $a->{ _started_at } <=> $b->{ _started_at } } values %{ $self->{ test_by_pid } };
+
+    local $LIST_SEPARATOR = ', ';
+    my @labels = map { "$_->{ label } (".timestr( $now - $_->{ _started_at } ).')' } @running;
+    $self->print_info( 'progress: '.timestr( $now - $self->{ started } )." elapsed; running: @labels\n" );
+
+    return;
 }
 
 sub print_test_fail_info
@@ -786,6 +1862,9 @@ sub print_test_fail_info
         return;
     }
 
+    # the coordinator reports failures of the tests run by workers
+    return if defined( $self->{ connect } );
+
     my $msg = "$test->{ label } failed";
     if ($test->{ insignificant_test }) {
         $msg .= ', but it is marked with insignificant_test';
@@ -816,9 +1895,11 @@ sub print_test_fail_info
     return;
 }
 
+# Runs @cmd in a child process and returns its pid.
+# If $options->{ output } is set, the output of the process is written to that file.
 sub spawn
 {
-    my ($self, @cmd) = @_;
+    my ($self, $options, @cmd) = @_;
 
     my $pid;
 
@@ -831,9 +1912,21 @@ sub spawn
             die "fork: $!";
         }
         if ($pid == 0) {
+            # A process group of our own lets us stop the test along with testrunner,
+            # which runs it as a child process.  Being in the background, the test
+            # must not read from the terminal.
+            setpgrp( 0, 0 ) || die "setpgrp: $!";
+            open( STDIN, '<', File::Spec->devnull( ) ) || die "open /dev/null: $!";
+            if (my $output = $options->{ output }) {
+                open( STDOUT, '>', $output ) || die "open $output: $!";
+                open( STDERR, '>&', \*STDOUT ) || die "dup STDOUT: $!";
+            }
             exec( @cmd );
             die "exec: $!";
         }
+        # also set it here, so it is in place before we might signal the group;
+        # this fails harmlessly if the child has already exec'd.
+        setpgrp( $pid, $pid );
     }
 
     $self->debug( sub { "spawned $pid <- ".join(' ', map { "[$_]" } @cmd) } );
@@ -847,7 +1940,7 @@ sub exit_appropriately
 
     my $fail = any { $_->{ _status } && !$_->{ insignificant_test } } @tests;
 
-    exit( $fail ? 1 : 0 );
+    exit( ($fail || $self->{ aborted }) ? 1 : 0 );
 }
 
 #======= static functions =========================================================================
@@ -903,6 +1996,20 @@ sub timestr
     return "@out";
 }
 
+# Sends $signal to the test spawned as $pid.  Outside of Windows, the whole
+# process group is signalled, so the signal reaches the test as well as
+# testrunner.
+sub kill_test
+{
+    my ($signal, $pid) = @_;
+
+    if ($OSNAME =~ m{win32}i) {
+        return kill( $signal, $pid );
+    }
+
+    return kill( $signal, -$pid );
+}
+
 #==================================================================================================
 
 QtQA::App::TestScheduler->new( )->run( @ARGV ) if (!caller);
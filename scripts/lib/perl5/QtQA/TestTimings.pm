@@ -0,0 +1,184 @@
+#############################################################################
+##
+## Copyright (C) 2026 The Qt Company Ltd.
+## Contact: https://www.qt.io/licensing/
+##
+## This file is part of the Quality Assurance module of the Qt Toolkit.
+##
+## $QT_BEGIN_LICENSE:GPL-EXCEPT$
+## Commercial License Usage
+## Licensees holding valid commercial Qt licenses may use this file in
+## accordance with the commercial license agreement provided with the
+## Software or, alternatively, in accordance with the terms contained in
+## a written agreement between you and The Qt Company. For licensing terms
+## and conditions see https://www.qt.io/terms-conditions. For further
+## information use the contact form at https://www.qt.io/contact-us.
+##
+## GNU General Public License Usage
+## Alternatively, this file may be used under the terms of the GNU
+## General Public License version 3 as published by the Free Software
+## Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+## included in the packaging of this file. Please review the following
+## information to ensure the GNU General Public License requirements will
+## be met: https://www.gnu.org/licenses/gpl-3.0.html.
+##
+## $QT_END_LICENSE$
+##
+#############################################################################
+
+package QtQA::TestTimings;
+use strict;
+use warnings;
+
+use Carp;
+use File::Basename;
+use File::Temp;
+use JSON::PP;
+
+# Weight of a new duration in the moving average; older runs decay by (1 - this) per run.
+my $SMOOTHING = 0.3;
+
+sub new
+{
+    my ($class, $path) = @_;
+
+    my $self = bless {
+        path => $path,
+        tests => {},
+    }, $class;
+
+    if (-e $path) {
+        my $fh;
+        open( $fh, '<', $path ) || croak "open $path for read: $!";
+        my $json = do { local $/; <$fh> };
+        close( $fh );
+
+        my $data = eval { JSON::PP->new( )->decode( $json ) };
+        if (my $error = $@) {
+            croak "$path: error: $error";
+        }
+        $self->{ tests } = $data->{ tests } || {};
+    }
+
+    return $self;
+}
+
+sub path
+{
+    my ($self) = @_;
+    return $self->{ path };
+}
+
+sub estimate
+{
+    my ($self, $label) = @_;
+
+    my $entry = $self->{ tests }{ $label };
+    return $entry ? $entry->{ seconds } : undef;
+}
+
+sub record
+{
+    my ($self, $label, $seconds) = @_;
+
+    my $entry = $self->{ tests }{ $label } ||= { runs => 0 };
+    if ($entry->{ runs }) {
+        $entry->{ seconds } = $SMOOTHING * $seconds + (1 - $SMOOTHING) * $entry->{ seconds };
+    } else {
+        $entry->{ seconds } = $seconds;
+    }
+    ++$entry->{ runs };
+
+    return;
+}
+
+sub save
+{
+    my ($self) = @_;
+
+    my $path = $self->{ path };
+
+    # write to a temporary file and rename it, so the database is never left half-written
+    # if we are interrupted.
+    my $fh = File::Temp->new(
+        TEMPLATE => basename( $path ).'.XXXXXX',
+        DIR => dirname( $path ),
+        UNLINK => 0,
+    );
+    print $fh JSON::PP->new( )->canonical( )->pretty( )->encode( {
+        version => 1,
+        tests => $self->{ tests },
+    } );
+    if (!close( $fh )) {
+        my $error = $!;
+        unlink( $fh->filename( ) );
+        croak "write $path: $error";
+    }
+
+    if (!rename( $fh->filename( ), $path )) {
+        my $error = $!;
+        unlink( $fh->filename( ) );
+        croak "rename to $path: $error";
+    }
+
+    return;
+}
+
+=head1 NAME
+
+QtQA::TestTimings - database of the durations of autotests
+
+=head1 SYNOPSIS
+
+  use QtQA::TestTimings;
+
+  my $timings = QtQA::TestTimings->new( 'test-timings.json' );
+
+  # run the longest tests first
+  my @tests = sort { ($timings->estimate( $b ) // 0) <=> ($timings->estimate( $a ) // 0) } @labels;
+
+  ...
+  $timings->record( 'tst_qstring', 12.5 );
+  $timings->save( );
+
+This module keeps the durations of previous runs of autotests in a small JSON file,
+so that tests can be scheduled according to how long they are expected to take.
+Tests are identified by their label in the testplan.
+
+=head1 METHODS
+
+=over
+
+=item B<new> $path
+
+Returns the database stored in the file at $path.
+If the file does not exist, the database is empty, and it is created on L<save>.
+Dies if the file exists but cannot be parsed.
+
+=item B<estimate> $label
+
+Returns the expected duration of the test with the given $label, in seconds,
+or undef if the test has never been recorded.
+
+=item B<record> $label, $seconds
+
+Records that a run of the test with the given $label took $seconds.
+The estimate of a test is an exponential moving average of the recorded
+durations, so that it follows tests which get faster or slower over time
+without being thrown off much by a single slow run.
+
+=item B<save>
+
+Writes the database back to its file.  The file is replaced atomically.
+If several processes update the same database concurrently, the
+durations recorded by all but the last one to save are lost.
+
+=item B<path>
+
+Returns the path of the database file.
+
+=back
+
+=cut
+
+1;
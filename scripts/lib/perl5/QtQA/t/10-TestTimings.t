@@ -0,0 +1,74 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+
+=head1 NAME
+
+10-TestTimings.t - test QtQA::TestTimings module
+
+=cut
+
+use FindBin;
+use lib "$FindBin::Bin/../..";
+
+use File::Spec::Functions;
+use File::Temp;
+use IO::File;
+use Test::More;
+
+BEGIN { use_ok 'QtQA::TestTimings'; }
+
+sub test_record_and_save
+{
+    my $dir = File::Temp->newdir( );
+    my $path = catfile( "$dir", 'timings.json' );
+
+    my $timings = QtQA::TestTimings->new( $path );
+    ok( !-e $path, 'database is not created until saved' );
+    is( $timings->estimate( 'tst_foo' ), undef, 'unknown test has no estimate' );
+
+    $timings->record( 'tst_foo', 10 );
+    is( $timings->estimate( 'tst_foo' ), 10, 'first run is the estimate' );
+
+    $timings->record( 'tst_foo', 20 );
+    $timings->record( 'tst_bar', 1 );
+    my $estimate = $timings->estimate( 'tst_foo' );
+    ok( $estimate > 10 && $estimate < 20, 'later runs are averaged' ) || diag "estimate: $estimate";
+
+    $timings->save( );
+    ok( -e $path, 'database is saved' );
+
+    my $reloaded = QtQA::TestTimings->new( $path );
+    is( $reloaded->estimate( 'tst_foo' ), $estimate, 'estimate is preserved' );
+    is( $reloaded->estimate( 'tst_bar' ), 1, 'other tests are preserved' );
+
+    my @files = glob( catfile( "$dir", '*' ) );
+    is( scalar(@files), 1, 'no temporary files are left behind' ) || diag "files: @files";
+
+    return;
+}
+
+sub test_invalid
+{
+    my $dir = File::Temp->newdir( );
+    my $path = catfile( "$dir", 'timings.json' );
+
+    IO::File->new( $path, '>' )->print( "not json\n" );
+
+    ok( !eval { QtQA::TestTimings->new( $path ) }, 'invalid database is not loaded' );
+    like( $@, qr{\Q$path\E: error:}, 'error mentions the database' );
+
+    return;
+}
+
+sub run
+{
+    test_record_and_save;
+    test_invalid;
+    done_testing;
+
+    return;
+}
+
+run if (!caller);
+1;
@@ -0,0 +1,503 @@
+package main
+
+import (
+	"archive/zip"
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"path"
+	"path/filepath"
+	"sync"
+	"time"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// manifestFileName is the name of the file in a results archive that lists the benchmark
+// runs stored in it, so that an interrupted run can be resumed.
+const manifestFileName = "manifest.json"
+
+type archiveManifest struct {
+	// Completed lists the result files of the benchmark runs stored in the archive.
+	Completed []string
+	// Failed maps the result files of failed benchmark runs to their error.
+	Failed map[string]string
+}
+
+// incrementalArchive collects the results of benchmark runs in a staging directory next to
+// the archive as soon as each run finishes, along with a manifest of the completed and failed
+// runs. The benchmarks write their results directly into the staging directory, and finish
+// writes the archive from it once at the end. If benchmarkrunner is interrupted, the staging
+// directory is kept, so that the run can be resumed from it.
+type incrementalArchive struct {
+	path string
+	// dir is the staging directory, the path of the archive with .partial appended.
+	dir       string
+	mutex     sync.Mutex
+	manifest  archiveManifest
+	completed map[string]bool
+	// table holds the benchmark results of all completed runs.
+	table *goqtestlib.ResultsTable
+}
+
+// createIncrementalArchive starts collecting results for an archive at path, with an empty
+// staging directory. An existing archive at path is replaced when the archive is finished.
+// When resuming, the runs listed as completed in the manifest of the staging directory of an
+// interrupted run, or otherwise of the existing archive, are not repeated.
+func createIncrementalArchive(path string, resume bool) (*incrementalArchive, error) {
+	// the benchmarks run in their own directories and need an absolute path.
+	dir, err := filepath.Abs(path + ".partial")
+	if err != nil {
+		return nil, err
+	}
+	archive := &incrementalArchive{
+		path:      path,
+		dir:       dir,
+		manifest:  archiveManifest{Failed: map[string]string{}},
+		completed: map[string]bool{},
+		table:     &goqtestlib.ResultsTable{},
+	}
+
+	if resume {
+		if _, statErr := os.Stat(filepath.Join(archive.dir, manifestFileName)); statErr == nil {
+			err = archive.resumeStaging()
+		} else if _, statErr := os.Stat(path); statErr == nil {
+			err = archive.resumeArchive()
+		} else {
+			return archive, archive.createStaging()
+		}
+		if err != nil {
+			return nil, err
+		}
+		fmt.Printf("Resuming %s with %v completed benchmark runs\n", path, len(archive.manifest.Completed))
+		return archive, nil
+	}
+
+	return archive, archive.createStaging()
+}
+
+// createStaging replaces the staging directory with an empty one.
+func (archive *incrementalArchive) createStaging() error {
+	if err := os.RemoveAll(archive.dir); err != nil {
+		return err
+	}
+	if err := os.MkdirAll(archive.dir, 0755); err != nil {
+		return err
+	}
+	return archive.writeManifest()
+}
+
+func (archive *incrementalArchive) readManifest(contents io.Reader, source string) error {
+	if err := json.NewDecoder(contents).Decode(&archive.manifest); err != nil {
+		return fmt.Errorf("Error reading manifest of %s: %s", source, err)
+	}
+	if archive.manifest.Failed == nil {
+		archive.manifest.Failed = map[string]string{}
+	}
+	for _, name := range archive.manifest.Completed {
+		archive.completed[name] = true
+	}
+	return nil
+}
+
+// resumeStaging continues with the staging directory of an interrupted run.
+func (archive *incrementalArchive) resumeStaging() error {
+	manifest, err := os.Open(filepath.Join(archive.dir, manifestFileName))
+	if err != nil {
+		return err
+	}
+	defer manifest.Close()
+	if err := archive.readManifest(manifest, archive.dir); err != nil {
+		return err
+	}
+
+	for _, resultFile := range archive.manifest.Completed {
+		if err := archive.addToTable(resultFile); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// resumeArchive continues with the runs of the finished archive, which are extracted into
+// a new staging directory.
+func (archive *incrementalArchive) resumeArchive() error {
+	reader, err := zip.OpenReader(archive.path)
+	if err != nil {
+		return fmt.Errorf("Error opening archive to resume: %s", err)
+	}
+	defer reader.Close()
+
+	if archive.table, err = archivedResultsTable(&reader.Reader); err != nil {
+		return err
+	}
+
+	if err := os.RemoveAll(archive.dir); err != nil {
+		return err
+	}
+
+	hasManifest := false
+	for _, entry := range reader.File {
+		if entry.Name == goqtestlib.ResultsTableFileName {
+			continue
+		}
+		contents, err := entry.Open()
+		if err != nil {
+			return err
+		}
+		if entry.Name == manifestFileName {
+			hasManifest = true
+			err = archive.readManifest(contents, archive.path)
+		} else {
+			err = extractFile(contents, filepath.Join(archive.dir, filepath.FromSlash(entry.Name)))
+		}
+		contents.Close()
+		if err != nil {
+			return err
+		}
+	}
+	if !hasManifest {
+		os.RemoveAll(archive.dir)
+		return fmt.Errorf("%s has no manifest and cannot be resumed", archive.path)
+	}
+
+	if err := os.MkdirAll(archive.dir, 0755); err != nil {
+		return err
+	}
+	return archive.writeManifest()
+}
+
+func extractFile(contents io.Reader, path string) error {
+	if err := os.MkdirAll(filepath.Dir(path), 0755); err != nil {
+		return err
+	}
+	file, err := os.Create(path)
+	if err != nil {
+		return err
+	}
+	if _, err := io.Copy(file, contents); err != nil {
+		file.Close()
+		return err
+	}
+	return file.Close()
+}
+
+// writeManifest replaces the manifest in the staging directory.
+func (archive *incrementalArchive) writeManifest() error {
+	contents, err := json.MarshalIndent(&archive.manifest, "", "    ")
+	if err != nil {
+		return err
+	}
+	path := filepath.Join(archive.dir, manifestFileName)
+	if err := ioutil.WriteFile(path+".tmp", append(contents, '\n'), 0644); err != nil {
+		return err
+	}
+	return os.Rename(path+".tmp", path)
+}
+
+// addToTable adds the results of a completed run in the staging directory to the results table.
+func (archive *incrementalArchive) addToTable(resultFile string) error {
+	contents, err := ioutil.ReadFile(filepath.Join(archive.dir, filepath.FromSlash(resultFile)))
+	if err != nil {
+		return err
+	}
+	testCase, err := goqtestlib.ParseBenchmarkResults(bytes.NewReader(contents))
+	if err != nil {
+		return fmt.Errorf("Error reading %s: %s", resultFile, err)
+	}
+	archive.table.AddResultsFile(goqtestlib.NewResultsFile(resultFile, contents), testCase)
+	return nil
+}
+
+// isCompleted returns true if the results of the run are already in the archive.
+func (archive *incrementalArchive) isCompleted(resultFile string) bool {
+	archive.mutex.Lock()
+	defer archive.mutex.Unlock()
+	return archive.completed[resultFile]
+}
+
+// hasFile returns true if the staging directory contains a file of the given name.
+func (archive *incrementalArchive) hasFile(name string) bool {
+	_, err := os.Stat(filepath.Join(archive.dir, filepath.FromSlash(name)))
+	return err == nil
+}
+
+// addRun records a finished benchmark run, whose results and profiles are in the staging
+// directory, in the manifest, or records its failure.
+func (archive *incrementalArchive) addRun(task benchmarkTask, runErr error) error {
+	archive.mutex.Lock()
+	defer archive.mutex.Unlock()
+
+	resultFile := goqtestlib.RepetitionFileName(task.benchmark.Name, task.repetition)
+	if runErr != nil {
+		archive.manifest.Failed[resultFile] = runErr.Error()
+		return archive.writeManifest()
+	}
+
+	if err := archive.addToTable(resultFile); err != nil {
+		return err
+	}
+
+	delete(archive.manifest.Failed, resultFile)
+	if !archive.completed[resultFile] {
+		archive.completed[resultFile] = true
+		archive.manifest.Completed = append(archive.manifest.Completed, resultFile)
+	}
+	return archive.writeManifest()
+}
+
+// failures returns the result files of the failed runs and their errors.
+func (archive *incrementalArchive) failures() map[string]string {
+	archive.mutex.Lock()
+	defer archive.mutex.Unlock()
+	return archive.manifest.Failed
+}
+
+// finish writes the archive with the results and profiles of the completed runs, the
+// calibration and environment if present, the manifest and the results table. The staging
+// directory is removed afterwards.
+func (archive *incrementalArchive) finish() error {
+	archive.mutex.Lock()
+	defer archive.mutex.Unlock()
+
+	var files []string
+	for _, resultFile := range archive.manifest.Completed {
+		files = append(files, resultFile)
+		name, repetition := goqtestlib.SplitRepetitionFileName(resultFile)
+		for _, kind := range profileKinds {
+			if profile := goqtestlib.ProfileFileName(name, repetition, kind); archive.hasFile(profile) {
+				files = append(files, profile)
+			}
+		}
+	}
+	for _, name := range []string{goqtestlib.BenchmarkCalibrationFileName, goqtestlib.BenchmarkEnvironmentFileName} {
+		if archive.hasFile(name) {
+			files = append(files, name)
+		}
+	}
+
+	err := writeArchive(archive.path, func(archiver *zip.Writer) error {
+		for _, name := range files {
+			if err := addFileToArchive(archiver, filepath.Join(archive.dir, filepath.FromSlash(name)), name); err != nil {
+				return err
+			}
+		}
+		if err := addFileToArchive(archiver, filepath.Join(archive.dir, manifestFileName), manifestFileName); err != nil {
+			return err
+		}
+		return writeResultsTable(archiver, archive.table)
+	})
+	if err != nil {
+		return err
+	}
+	return os.RemoveAll(archive.dir)
+}
+
+func addFileToArchive(archiver *zip.Writer, path string, name string) error {
+	info, err := os.Stat(path)
+	if err != nil {
+		return err
+	}
+
+	sourceFile, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer sourceFile.Close()
+
+	header, err := zip.FileInfoHeader(info)
+	if err != nil {
+		return err
+	}
+	header.Name = name
+
+	file, err := archiver.CreateHeader(header)
+	if err != nil {
+		return err
+	}
+
+	n, err := io.Copy(file, sourceFile)
+	if err == nil && n != info.Size() {
+		return fmt.Errorf("Incorrect number of bytes written to archive for %s: Wrote %v expected %v", path, n, info.Size())
+	}
+	return err
+}
+
+// writeArchive writes a new archive next to the one at archivePath, with the entries added by
+// addEntries, and renames it over the old one when done, so that a failure leaves the
+// original archive intact.
+func writeArchive(archivePath string, addEntries func(*zip.Writer) error) error {
+	outputFile, err := ioutil.TempFile(filepath.Dir(archivePath), filepath.Base(archivePath))
+	if err != nil {
+		return err
+	}
+	defer os.Remove(outputFile.Name())
+	defer outputFile.Close()
+	if err := outputFile.Chmod(0644); err != nil {
+		return err
+	}
+
+	archiver := zip.NewWriter(outputFile)
+	if err := addEntries(archiver); err != nil {
+		return err
+	}
+
+	if err := archiver.Close(); err != nil {
+		return err
+	}
+	if err := outputFile.Close(); err != nil {
+		return err
+	}
+	return os.Rename(outputFile.Name(), archivePath)
+}
+
+// replaceArchive is like writeArchive, but first copies the entries of the existing archive
+// without recompressing them, except for those that skipEntry returns true for.
+func replaceArchive(archivePath string, skipEntry func(name string) bool, addEntries func(*zip.Writer) error) error {
+	existing, err := zip.OpenReader(archivePath)
+	if err != nil && !os.IsNotExist(err) {
+		return fmt.Errorf("Error opening %s: %s", archivePath, err)
+	}
+	if err == nil {
+		defer existing.Close()
+	}
+
+	return writeArchive(archivePath, func(archiver *zip.Writer) error {
+		if existing != nil {
+			for _, entry := range existing.File {
+				if skipEntry(entry.Name) {
+					continue
+				}
+				if err := archiver.Copy(entry); err != nil {
+					return fmt.Errorf("Error copying %s: %s", entry.Name, err)
+				}
+			}
+		}
+		return addEntries(archiver)
+	})
+}
+
+func writeResultsTable(archiver *zip.Writer, table *goqtestlib.ResultsTable) error {
+	file, err := archiver.CreateHeader(&zip.FileHeader{Name: goqtestlib.ResultsTableFileName, Method: zip.Deflate, Modified: time.Now()})
+	if err != nil {
+		return err
+	}
+	return table.Write(file)
+}
+
+// archivedResultsFiles describes the XML files in the archive.
+func archivedResultsFiles(reader *zip.Reader) []goqtestlib.ResultsFile {
+	var files []goqtestlib.ResultsFile
+	for _, entry := range reader.File {
+		if path.Ext(entry.Name) == ".xml" {
+			files = append(files, goqtestlib.ResultsFile{Name: entry.Name, Size: entry.UncompressedSize64, CRC32: entry.CRC32})
+		}
+	}
+	return files
+}
+
+// archivedResultsTable returns the results table of the archive. For archives written before
+// results tables were added, with a corrupt table, or whose XML files don't match the table,
+// it is built from the results in the archive.
+func archivedResultsTable(reader *zip.Reader) (*goqtestlib.ResultsTable, error) {
+	for _, entry := range reader.File {
+		if entry.Name != goqtestlib.ResultsTableFileName {
+			continue
+		}
+		contents, err := entry.Open()
+		if err != nil {
+			return nil, err
+		}
+		table, err := goqtestlib.ReadResultsTable(contents)
+		contents.Close()
+		if err != nil {
+			fmt.Printf("Warning: %s, reading the XML results instead\n", err)
+			break
+		}
+		if table.Covers(archivedResultsFiles(reader)) {
+			return table, nil
+		}
+	}
+
+	table := &goqtestlib.ResultsTable{}
+	for _, entry := range reader.File {
+		if path.Ext(entry.Name) != ".xml" {
+			continue
+		}
+		contents, err := entry.Open()
+		if err != nil {
+			return nil, err
+		}
+		testCase, err := goqtestlib.ParseBenchmarkResults(contents)
+		contents.Close()
+		if err != nil {
+			fmt.Printf("Warning: Skipping %s: %s\n", entry.Name, err)
+			testCase = nil
+		}
+		table.AddResultsFile(goqtestlib.ResultsFile{Name: entry.Name, Size: entry.UncompressedSize64, CRC32: entry.CRC32}, testCase)
+	}
+	return table, nil
+}
+
+// mergeResultsIntoArchive adds the results in the results directory to an existing archive.
+// They are numbered as further repetitions of the benchmarks already in the archive, so that
+// qtestcompare treats them as additional samples. The archive keeps its original description
+// of the environment, and its results table is extended.
+func mergeResultsIntoArchive(resultsDir string, archivePath string) error {
+	existing, err := zip.OpenReader(archivePath)
+	if err != nil {
+		return fmt.Errorf("Error opening archive to merge into: %s", err)
+	}
+
+	table, err := archivedResultsTable(&existing.Reader)
+	if err != nil {
+		existing.Close()
+		return err
+	}
+
+	repetitions := map[string]int{}
+	for _, entry := range existing.File {
+		if filepath.Ext(entry.Name) != ".xml" {
+			continue
+		}
+		name, repetition := goqtestlib.SplitRepetitionFileName(entry.Name)
+		if repetition > repetitions[name] {
+			repetitions[name] = repetition
+		}
+	}
+	existing.Close()
+
+	isResultsTable := func(name string) bool { return name == goqtestlib.ResultsTableFileName }
+	return replaceArchive(archivePath, isResultsTable, func(archiver *zip.Writer) error {
+		err := filepath.Walk(resultsDir, func(path string, info os.FileInfo, err error) error {
+			if err != nil || info.IsDir() || filepath.Ext(path) != ".xml" {
+				return err
+			}
+			relativePath, err := filepath.Rel(resultsDir, path)
+			if err != nil {
+				return err
+			}
+			name, repetition := goqtestlib.SplitRepetitionFileName(filepath.ToSlash(relativePath))
+			archivedName := goqtestlib.RepetitionFileName(name, repetitions[name]+repetition)
+
+			contents, err := ioutil.ReadFile(path)
+			if err != nil {
+				return err
+			}
+			testCase, err := goqtestlib.ParseBenchmarkResults(bytes.NewReader(contents))
+			if err != nil {
+				return fmt.Errorf("Error reading %s: %s", path, err)
+			}
+			table.AddResultsFile(goqtestlib.NewResultsFile(archivedName, contents), testCase)
+
+			return addFileToArchive(archiver, path, archivedName)
+		})
+		if err != nil {
+			return err
+		}
+		return writeResultsTable(archiver, table)
+	})
+}
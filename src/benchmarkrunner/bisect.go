@@ -0,0 +1,340 @@
+package main
+
+import (
+	"crypto/sha1"
+	"encoding/hex"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io/ioutil"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+	"github.com/kardianos/osext"
+)
+
+// Exit codes of a bisection step, as understood by git bisect run.
+const (
+	bisectGood  = 0
+	bisectBad   = 1
+	bisectSkip  = 125
+	bisectAbort = 128
+)
+
+// bisectConfig is shared between the bisect command and the bisect-step commands that
+// git bisect run starts for every tested commit.
+type bisectConfig struct {
+	Benchmark        goqtestlib.BenchmarkID
+	Metric           string
+	SourceDirectory  string
+	BuildDirectory   string
+	BuildCommand     string
+	WorkingDirectory string
+	CacheDirectory   string
+	Repetitions      int
+	DisableASLR      bool
+	BenchmarkArgs    []string
+	Options          goqtestlib.ComparisonOptions
+	// Good holds the samples measured at the good commit, that every step is compared against.
+	Good []float64
+}
+
+func git(sourceDir string, args ...string) (string, error) {
+	cmd := exec.Command("git", args...)
+	cmd.Dir = sourceDir
+	cmd.Stderr = os.Stderr
+	output, err := cmd.Output()
+	if err != nil {
+		return "", fmt.Errorf("Error running git %s: %s", strings.Join(args, " "), err)
+	}
+	return strings.TrimSpace(string(output)), nil
+}
+
+// cacheDirectory returns the directory the results of the configured benchmark are cached
+// in for the given commit. Different benchmark arguments measure different things, so they
+// are part of the key.
+func (config *bisectConfig) cacheDirectory(commit string) string {
+	key := sha1.Sum([]byte(config.Benchmark.String() + "\x00" + strings.Join(config.BenchmarkArgs, "\x00")))
+	return filepath.Join(config.CacheDirectory, commit, hex.EncodeToString(key[:]))
+}
+
+// samples returns all values measured for the configured benchmark and metric in the results
+// directory. If no metric is configured yet, the first metric found is chosen.
+func (config *bisectConfig) samples(resultsDir string) ([]float64, error) {
+	record, err := historyRecordFromResults(resultsDir, "")
+	if err != nil {
+		return nil, err
+	}
+	for _, result := range record.Results {
+		if result.Benchmark != config.Benchmark.String() {
+			continue
+		}
+		if config.Metric == "" {
+			config.Metric = result.Metric
+		}
+		if result.Metric == config.Metric {
+			return result.Values, nil
+		}
+	}
+	return nil, fmt.Errorf("No %s results found for %s", config.Metric, config.Benchmark)
+}
+
+// measure builds the checked out commit and runs the configured benchmark. The results are
+// cached per commit, so that commits that have already been measured are neither built nor
+// run again. An error means that the commit cannot be measured and should be skipped.
+func (config *bisectConfig) measure(commit string) ([]float64, error) {
+	cacheDir := config.cacheDirectory(commit)
+	if samples, err := config.samples(cacheDir); err == nil && len(samples) >= config.Repetitions {
+		fmt.Printf("Using cached results for %s\n", commit)
+		return samples, nil
+	}
+
+	fmt.Printf("Building %s\n", commit)
+	build := exec.Command("sh", "-c", config.BuildCommand)
+	build.Dir = config.BuildDirectory
+	build.Stdout = os.Stdout
+	build.Stderr = os.Stderr
+	if err := build.Run(); err != nil {
+		return nil, fmt.Errorf("Error building %s: %s", commit, err)
+	}
+
+	self, err := osext.Executable()
+	if err != nil {
+		return nil, fmt.Errorf("Unable to determine current executable name: %s", err)
+	}
+	benchmarks, err := discoverBenchmarks(self, config.WorkingDirectory, autoDiscovery, "benchmark")
+	if err != nil {
+		return nil, err
+	}
+	var selected []benchmark
+	for _, b := range benchmarks {
+		if b.Name == config.Benchmark.Test {
+			selected = append(selected, b)
+		}
+	}
+	if len(selected) == 0 {
+		return nil, fmt.Errorf("Benchmark %s not found in %s", config.Benchmark.Test, commit)
+	}
+
+	selector := config.Benchmark.Function
+	if config.Benchmark.Tag != "" {
+		selector += ":" + config.Benchmark.Tag
+	}
+
+	if err := os.MkdirAll(filepath.Dir(cacheDir), 0755); err != nil {
+		return nil, err
+	}
+	resultsDir, err := ioutil.TempDir(filepath.Dir(cacheDir), "running")
+	if err != nil {
+		return nil, err
+	}
+	defer os.RemoveAll(resultsDir)
+
+	options := runOptions{
+		repetitions:   config.Repetitions,
+		jobs:          1,
+		disableASLR:   config.DisableASLR,
+		benchmarkArgs: append([]string{selector}, config.BenchmarkArgs...),
+	}
+	if err := runBenchmarks(selected, resultsDir, options); err != nil {
+		return nil, err
+	}
+
+	samples, err := config.samples(resultsDir)
+	if err != nil {
+		return nil, err
+	}
+
+	// only complete measurements end up in the cache.
+	os.RemoveAll(cacheDir)
+	if err := os.Rename(resultsDir, cacheDir); err != nil {
+		return nil, err
+	}
+	return samples, nil
+}
+
+func (config *bisectConfig) measureCommit(commit string) ([]float64, error) {
+	if _, err := git(config.SourceDirectory, "checkout", "-q", commit); err != nil {
+		return nil, err
+	}
+	return config.measure(commit)
+}
+
+func describeComparison(metric string, comparison goqtestlib.SampleComparison) string {
+	unit := goqtestlib.MetricUnit(metric)
+	description := fmt.Sprintf("%s: %.2f %s -> %.2f %s (%+.2f%%", metric, comparison.OldMedian, unit, comparison.NewMedian, unit, comparison.Change)
+	if comparison.Tested {
+		description += fmt.Sprintf(", p=%.3f", comparison.PValue)
+	}
+	return description + ")"
+}
+
+func readBisectConfig(path string) (*bisectConfig, error) {
+	data, err := ioutil.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	config := &bisectConfig{}
+	if err := json.Unmarshal(data, config); err != nil {
+		return nil, fmt.Errorf("Error reading bisect configuration %s: %s", path, err)
+	}
+	return config, nil
+}
+
+// bisectStep is run by git bisect run for every commit to test. The exit code tells git
+// whether the benchmark regressed compared to the good commit.
+func bisectStep(configFile string) int {
+	config, err := readBisectConfig(configFile)
+	if err != nil {
+		fmt.Printf("%s\n", err)
+		return bisectAbort
+	}
+
+	commit, err := git(config.SourceDirectory, "rev-parse", "HEAD")
+	if err != nil {
+		fmt.Printf("%s\n", err)
+		return bisectAbort
+	}
+
+	samples, err := config.measure(commit)
+	if err != nil {
+		fmt.Printf("Skipping %s: %s\n", commit, err)
+		return bisectSkip
+	}
+
+	comparison := goqtestlib.CompareSamples(config.Good, samples, config.Options)
+	fmt.Printf("%s %s\n", commit, describeComparison(config.Metric, comparison))
+	if comparison.Regression(config.Metric) {
+		return bisectBad
+	}
+	return bisectGood
+}
+
+// bisect finds the commit that introduced a regression of a single benchmark with git bisect.
+// The good and the bad commit are measured first, to make sure that the regression can be
+// reproduced with the given number of repetitions. Then git bisect run calls benchmarkrunner
+// bisect-step for every commit, which marks the commit as bad if the benchmark is
+// significantly worse than at the good commit.
+func bisect(workingDir string, args []string) error {
+	flags := flag.NewFlagSet("bisect", flag.ExitOnError)
+	config := &bisectConfig{WorkingDirectory: workingDir}
+	var good, bad, benchmarkID, method string
+	flags.StringVar(&good, "good", "", "A commit without the regression")
+	flags.StringVar(&bad, "bad", "HEAD", "A commit with the regression")
+	flags.StringVar(&benchmarkID, "benchmark", "", "The regressed benchmark, as test:function or test:function:tag, with test being the directory of the benchmark")
+	flags.StringVar(&config.Metric, "metric", "", "The regressed metric. Defaults to the first metric the benchmark reports")
+	flags.StringVar(&config.BuildCommand, "build", "", "The shell command that builds the checked out commit, for example \"ninja\"")
+	flags.StringVar(&config.BuildDirectory, "build-dir", workingDir, "The directory to run the build command in")
+	flags.StringVar(&config.SourceDirectory, "source-dir", workingDir, "A directory in the git repository to bisect")
+	flags.StringVar(&config.CacheDirectory, "cache-dir", "", "Cache the results per commit in this directory. Defaults to a directory in the user's cache directory")
+	flags.IntVar(&config.Repetitions, "repetitions", 5, "Run the benchmark this many times for every commit")
+	flags.BoolVar(&config.DisableASLR, "disable-aslr", false, "Disable address space layout randomization for the benchmark (Linux only)")
+	flags.StringVar(&method, "method", "mannwhitney", "The significance test: mannwhitney or bootstrap")
+	config.Options = goqtestlib.DefaultComparisonOptions()
+	flags.Float64Var(&config.Options.Alpha, "alpha", config.Options.Alpha, "The significance level for considering a commit bad")
+	flags.Float64Var(&config.Options.Threshold, "threshold", config.Options.Threshold, "The minimum change in percent for considering a commit bad")
+	flags.Parse(args)
+	config.BenchmarkArgs = flags.Args()
+
+	if good == "" || benchmarkID == "" || config.BuildCommand == "" {
+		return fmt.Errorf("bisect needs at least -good, -benchmark and -build")
+	}
+
+	var err error
+	if config.Benchmark, err = goqtestlib.ParseBenchmarkID(benchmarkID); err != nil {
+		return err
+	}
+	if config.Options.Method, err = goqtestlib.ParseComparisonMethod(method); err != nil {
+		return err
+	}
+	if config.CacheDirectory == "" {
+		userCache, err := os.UserCacheDir()
+		if err != nil {
+			return err
+		}
+		config.CacheDirectory = filepath.Join(userCache, "benchmarkrunner", "bisect")
+	}
+	for _, dir := range []*string{&config.SourceDirectory, &config.BuildDirectory, &config.CacheDirectory} {
+		if *dir, err = filepath.Abs(*dir); err != nil {
+			return err
+		}
+	}
+
+	os.Setenv("QT_HASH_SEED", "0")
+
+	// resolve the revisions before checking anything out, as they may be relative to HEAD.
+	for _, revision := range []*string{&good, &bad} {
+		if *revision, err = git(config.SourceDirectory, "rev-parse", "--verify", *revision+"^{commit}"); err != nil {
+			return err
+		}
+	}
+
+	if _, err := git(config.SourceDirectory, "bisect", "start"); err != nil {
+		return err
+	}
+	defer git(config.SourceDirectory, "bisect", "reset")
+
+	if config.Good, err = config.measureCommit(good); err != nil {
+		return fmt.Errorf("Cannot measure the good commit: %s", err)
+	}
+	badSamples, err := config.measureCommit(bad)
+	if err != nil {
+		return fmt.Errorf("Cannot measure the bad commit: %s", err)
+	}
+
+	comparison := goqtestlib.CompareSamples(config.Good, badSamples, config.Options)
+	fmt.Printf("%s..%s %s\n", good, bad, describeComparison(config.Metric, comparison))
+	if !comparison.Regression(config.Metric) {
+		return fmt.Errorf("The regression of %s does not reproduce between %s and %s, try more repetitions", config.Benchmark, good, bad)
+	}
+
+	configFile, err := ioutil.TempFile("", "benchmarkbisect")
+	if err != nil {
+		return err
+	}
+	defer os.Remove(configFile.Name())
+	err = json.NewEncoder(configFile).Encode(config)
+	configFile.Close()
+	if err != nil {
+		return err
+	}
+
+	if _, err := git(config.SourceDirectory, "bisect", "bad", bad); err != nil {
+		return err
+	}
+	if _, err := git(config.SourceDirectory, "bisect", "good", good); err != nil {
+		return err
+	}
+
+	self, err := osext.Executable()
+	if err != nil {
+		return fmt.Errorf("Unable to determine current executable name: %s", err)
+	}
+	run := exec.Command("git", "bisect", "run", self, "bisect-step", configFile.Name())
+	run.Dir = config.SourceDirectory
+	run.Stdout = os.Stdout
+	run.Stderr = os.Stderr
+	if err := run.Run(); err != nil {
+		return fmt.Errorf("Error running git bisect: %s", err)
+	}
+
+	firstBad, err := git(config.SourceDirectory, "rev-parse", "refs/bisect/bad")
+	if err != nil {
+		return err
+	}
+	samples, err := config.samples(config.cacheDirectory(firstBad))
+	if err != nil {
+		return err
+	}
+	summary, err := git(config.SourceDirectory, "log", "-1", "--format=%h %s", firstBad)
+	if err != nil {
+		return err
+	}
+
+	fmt.Printf("\nFirst bad commit: %s\n", summary)
+	fmt.Printf("%s %s\n", config.Benchmark, describeComparison(config.Metric, goqtestlib.CompareSamples(config.Good, samples, config.Options)))
+	return nil
+}
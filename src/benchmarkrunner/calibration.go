@@ -0,0 +1,302 @@
+package main
+
+import (
+	"archive/zip"
+	"encoding/json"
+	"encoding/xml"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"math"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"time"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// calibrateBenchmarks runs every benchmark once with -minimumtotal, which makes QTestLib
+// increase the number of iterations of each wall time benchmark until one measurement takes
+// at least the target duration, and records these iteration counts. Benchmarks of other
+// metrics are not calibrated.
+func calibrateBenchmarks(benchmarks []benchmark, target time.Duration, options runOptions) (*goqtestlib.BenchmarkCalibration, error) {
+	calibrationDir, err := ioutil.TempDir("", "calibration")
+	if err != nil {
+		return nil, err
+	}
+	defer os.RemoveAll(calibrationDir)
+
+	targetMilliseconds := int(math.Ceil(target.Seconds() * 1000))
+	options.repetitions = 1
+	options.profiler = ""
+	options.resourceUsage = false
+	options.calibration = nil
+	options.archive = nil
+	options.benchmarkArgs = append(append([]string{}, options.benchmarkArgs...), "-minimumtotal", strconv.Itoa(targetMilliseconds))
+
+	fmt.Printf("Calibrating %v benchmarks to %v ms per measurement\n", len(benchmarks), targetMilliseconds)
+	if err := runBenchmarks(benchmarks, calibrationDir, options); err != nil {
+		return nil, fmt.Errorf("Error calibrating benchmarks: %s", err)
+	}
+
+	calibration := &goqtestlib.BenchmarkCalibration{
+		TargetMilliseconds: targetMilliseconds,
+		Iterations:         map[string]map[string]int{},
+	}
+	for _, b := range benchmarks {
+		file, err := os.Open(filepath.Join(calibrationDir, goqtestlib.RepetitionFileName(b.Name, 1)))
+		if err != nil {
+			return nil, err
+		}
+		testCase, err := goqtestlib.ParseBenchmarkResults(file)
+		file.Close()
+		if err != nil {
+			return nil, fmt.Errorf("Error reading calibration results of %s: %s", b.Name, err)
+		}
+
+		calibration.Iterations[b.Name] = calibratedIterations(testCase)
+	}
+	return calibration, nil
+}
+
+// calibratedIterations returns the iteration count of each benchmarked function:tag selector
+// of the calibration run, or 0 for benchmarks without a wall time result.
+func calibratedIterations(testCase *goqtestlib.ParsedTestResult) map[string]int {
+	iterations := map[string]int{}
+	for _, function := range testCase.Functions {
+		if function.Name == goqtestlib.ResourceUsageFunctionName {
+			continue
+		}
+		for _, result := range function.BenchmarkResults {
+			selector := function.Name
+			if result.Tag != "" {
+				selector += ":" + result.Tag
+			}
+			if result.Metric == "WalltimeMilliseconds" {
+				iterations[selector] = result.Iterations
+			} else if _, ok := iterations[selector]; !ok {
+				iterations[selector] = 0
+			}
+		}
+	}
+	return iterations
+}
+
+// isResourceUsage returns true if the selector is the resource usage recorded by
+// benchmarkrunner, which is not a function of the test. Calibrations recorded together with
+// -resource-usage may contain it.
+func isResourceUsage(selector string) bool {
+	return strings.SplitN(selector, ":", 2)[0] == goqtestlib.ResourceUsageFunctionName
+}
+
+func writeCalibration(resultsDir string, calibration *goqtestlib.BenchmarkCalibration) error {
+	contents, err := json.MarshalIndent(calibration, "", "    ")
+	if err != nil {
+		return err
+	}
+	return ioutil.WriteFile(filepath.Join(resultsDir, goqtestlib.BenchmarkCalibrationFileName), contents, 0644)
+}
+
+// readCalibration reads the iteration counts stored in a results archive, so that a run can
+// measure the benchmarks the same way as the run it is compared with.
+func readCalibration(archivePath string) (*goqtestlib.BenchmarkCalibration, error) {
+	archive, err := zip.OpenReader(archivePath)
+	if err != nil {
+		return nil, err
+	}
+	defer archive.Close()
+
+	for _, f := range archive.File {
+		if f.Name != goqtestlib.BenchmarkCalibrationFileName {
+			continue
+		}
+		reader, err := f.Open()
+		if err != nil {
+			return nil, err
+		}
+		defer reader.Close()
+		return decodeCalibration(reader, archivePath)
+	}
+	return nil, fmt.Errorf("%s was not recorded with calibrated iteration counts", archivePath)
+}
+
+// readCalibrationFile reads the iteration counts written by writeCalibration.
+func readCalibrationFile(path string) (*goqtestlib.BenchmarkCalibration, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer file.Close()
+	return decodeCalibration(file, path)
+}
+
+func decodeCalibration(reader io.Reader, source string) (*goqtestlib.BenchmarkCalibration, error) {
+	calibration := &goqtestlib.BenchmarkCalibration{}
+	if err := json.NewDecoder(reader).Decode(calibration); err != nil {
+		return nil, fmt.Errorf("Error reading calibration from %s: %s", source, err)
+	}
+	return calibration, nil
+}
+
+// isSelected returns true if the function:tag selector is part of the functions selected
+// with -select, which are either functions or function:tag selectors.
+func isSelected(selector string, functions []string) bool {
+	if len(functions) == 0 {
+		return true
+	}
+	function := strings.SplitN(selector, ":", 2)[0]
+	for _, f := range functions {
+		if f == selector || f == function {
+			return true
+		}
+	}
+	return false
+}
+
+// isCalibrated returns true if the calibration has iteration counts for the function or
+// function:tag selector.
+func isCalibrated(selector string, calibrated map[string]int) bool {
+	if _, ok := calibrated[selector]; ok {
+		return true
+	}
+	if strings.Contains(selector, ":") {
+		return false
+	}
+	for s := range calibrated {
+		if strings.HasPrefix(s, selector+":") {
+			return true
+		}
+	}
+	return false
+}
+
+// listTestFunctions returns the test functions of the benchmark, as listed by QTestLib's
+// -functions option.
+func listTestFunctions(b benchmark) ([]string, error) {
+	cmd := exec.Command(b.Command[0], append(append([]string{}, b.Command[1:]...), "-functions")...)
+	cmd.Dir = b.Directory
+	output, err := cmd.Output()
+	if err != nil {
+		return nil, fmt.Errorf("Error listing the functions of %s: %s", b.Name, err)
+	}
+	var functions []string
+	for _, line := range strings.Split(string(output), "\n") {
+		if line = strings.TrimSpace(line); strings.HasSuffix(line, "()") {
+			functions = append(functions, strings.TrimSuffix(line, "()"))
+		}
+	}
+	return functions, nil
+}
+
+// findUncalibratedFunctions returns the selected functions and function:tag selectors of each
+// calibrated benchmark that the calibration has no iteration counts for, for example because
+// they were added since the calibration was recorded. Without a selection, the functions of
+// the benchmark are listed by running it. Data rows added to calibrated functions are not
+// detected. Benchmarks missing from the calibration entirely run uncalibrated anyway.
+func findUncalibratedFunctions(benchmarks []benchmark, calibration *goqtestlib.BenchmarkCalibration) (map[string][]string, error) {
+	uncalibrated := map[string][]string{}
+	for _, b := range benchmarks {
+		calibrated, ok := calibration.Iterations[b.Name]
+		if !ok {
+			continue
+		}
+		selectors := b.Functions
+		if len(selectors) == 0 {
+			var err error
+			if selectors, err = listTestFunctions(b); err != nil {
+				return nil, err
+			}
+		}
+		for _, selector := range selectors {
+			if !isResourceUsage(selector) && !isCalibrated(selector, calibrated) {
+				uncalibrated[b.Name] = append(uncalibrated[b.Name], selector)
+			}
+		}
+		if missing := uncalibrated[b.Name]; len(missing) > 0 {
+			sort.Strings(missing)
+			fmt.Printf("Warning: No calibrated iteration counts for %s in %s, running them with QTestLib's default iterations\n", strings.Join(missing, ", "), b.Name)
+		}
+	}
+	return uncalibrated, nil
+}
+
+// invocations returns the additional arguments of each run of the benchmark executable that
+// make up one repetition of the benchmark. A calibrated benchmark runs once per distinct
+// iteration count, with -iterations and the functions calibrated to that count, and once more
+// without -iterations for selected functions missing from the calibration.
+func (options *runOptions) invocations(b benchmark) [][]string {
+	var calibrated map[string]int
+	if options.calibration != nil {
+		calibrated = options.calibration.Iterations[b.Name]
+	}
+
+	groups := map[int][]string{}
+	for selector, iterations := range calibrated {
+		if !isResourceUsage(selector) && isSelected(selector, b.Functions) {
+			groups[iterations] = append(groups[iterations], selector)
+		}
+	}
+	if len(groups) == 0 {
+		return [][]string{b.Functions}
+	}
+
+	counts := []int{}
+	for iterations := range groups {
+		counts = append(counts, iterations)
+	}
+	sort.Ints(counts)
+
+	var invocations [][]string
+	for _, iterations := range counts {
+		var args []string
+		if iterations > 0 {
+			args = append(args, "-iterations", strconv.Itoa(iterations))
+		}
+		sort.Strings(groups[iterations])
+		invocations = append(invocations, append(args, groups[iterations]...))
+	}
+	if uncalibrated := options.uncalibrated[b.Name]; len(uncalibrated) > 0 {
+		invocations = append(invocations, uncalibrated)
+	}
+	return invocations
+}
+
+// mergeTestResults combines the results of several runs of the same test executable into
+// one, as if all functions had been run in one go. Functions run more than once, such as
+// initTestCase, or functions whose data rows ran in different runs, are merged.
+func mergeTestResults(results []*goqtestlib.ParsedTestResult) *goqtestlib.ParsedTestResult {
+	merged := *results[0]
+	merged.Functions = nil
+	merged.Duration.Msecs = 0
+
+	index := map[string]int{}
+	for _, result := range results {
+		merged.Duration.Msecs += result.Duration.Msecs
+		for _, function := range result.Functions {
+			i, ok := index[function.Name]
+			if !ok {
+				index[function.Name] = len(merged.Functions)
+				merged.Functions = append(merged.Functions, function)
+				continue
+			}
+			existing := &merged.Functions[i]
+			existing.Incidents = append(existing.Incidents, function.Incidents...)
+			existing.Messages = append(existing.Messages, function.Messages...)
+			existing.BenchmarkResults = append(existing.BenchmarkResults, function.BenchmarkResults...)
+			existing.Duration.Msecs += function.Duration.Msecs
+		}
+	}
+	return &merged
+}
+
+func writeTestResult(path string, result *goqtestlib.ParsedTestResult) error {
+	contents, err := xml.MarshalIndent(result, "", "    ")
+	if err != nil {
+		return err
+	}
+	return ioutil.WriteFile(path, append([]byte(xml.Header), contents...), 0644)
+}
@@ -0,0 +1,52 @@
+package main
+
+import (
+	"reflect"
+	"testing"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+func TestCalibrationWithResourceUsage(t *testing.T) {
+	usage := resourceUsage{maxResidentSetBytes: 1 << 20, minorPageFaults: 100}
+	testCase := &goqtestlib.ParsedTestResult{Functions: []goqtestlib.TestFunction{
+		{Name: "toUpper", BenchmarkResults: []goqtestlib.BenchmarkResult{
+			{Metric: "WalltimeMilliseconds", Tag: "ascii", Value: 0.5, Iterations: 512},
+			{Metric: "WalltimeMilliseconds", Tag: "latin1", Value: 0.5, Iterations: 256},
+		}},
+		{Name: "instructions", BenchmarkResults: []goqtestlib.BenchmarkResult{{Metric: "InstructionReads", Value: 1000, Iterations: 1}}},
+		usage.testFunction(),
+	}}
+
+	iterations := calibratedIterations(testCase)
+	expected := map[string]int{"toUpper:ascii": 512, "toUpper:latin1": 256, "instructions": 0}
+	if !reflect.DeepEqual(iterations, expected) {
+		t.Errorf("Unexpected iterations %v, expected %v", iterations, expected)
+	}
+
+	// calibrations recorded before the resource usage was left out still contain it.
+	iterations[goqtestlib.ResourceUsageFunctionName] = 1
+	options := runOptions{
+		resourceUsage: true,
+		calibration:   &goqtestlib.BenchmarkCalibration{Iterations: map[string]map[string]int{"tst_qstring": iterations}},
+	}
+	b := benchmark{Name: "tst_qstring", Functions: []string{"toUpper", "instructions"}}
+
+	uncalibrated, err := findUncalibratedFunctions([]benchmark{b}, options.calibration)
+	if err != nil {
+		t.Fatalf("Error finding uncalibrated functions: %s", err)
+	}
+	if len(uncalibrated) != 0 {
+		t.Errorf("Unexpected uncalibrated functions %v", uncalibrated)
+	}
+
+	invocations := options.invocations(b)
+	expectedInvocations := [][]string{
+		{"instructions"},
+		{"-iterations", "256", "toUpper:latin1"},
+		{"-iterations", "512", "toUpper:ascii"},
+	}
+	if !reflect.DeepEqual(invocations, expectedInvocations) {
+		t.Errorf("Unexpected invocations %v, expected %v", invocations, expectedInvocations)
+	}
+}
@@ -0,0 +1,200 @@
+package main
+
+import (
+	"bufio"
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"os"
+	"os/exec"
+	"path"
+	"path/filepath"
+	"strings"
+)
+
+// benchmark describes one benchmark executable found in the build tree.
+type benchmark struct {
+	// Name is the directory of the benchmark relative to the directory benchmarkrunner
+	// was started in, and determines the name of its results in the archive.
+	Name      string
+	Directory string
+	Command   []string
+	// Functions restricts the benchmark to these functions or function:tag selectors.
+	Functions []string `json:",omitempty"`
+}
+
+// planBenchmark is called through TESTRUNNER by "make benchmark" for every benchmark, with the
+// command line of the benchmark as arguments. Instead of running the benchmark, it is recorded
+// in the plan file, as one JSON object per line.
+func planBenchmark(planFile string, workingDir string, command []string) error {
+	if len(command) == 0 {
+		return fmt.Errorf("No benchmark command given in %s", workingDir)
+	}
+
+	name, err := filepath.Rel(os.Getenv("QT_BENCHMARK_BASE_DIRECTORY"), workingDir)
+	if err != nil {
+		return fmt.Errorf("Could not determine relative directory: %s", err)
+	}
+	if name == "." {
+		name = "testcase"
+	}
+
+	executable := command[0]
+	if !filepath.IsAbs(executable) && filepath.Base(executable) != executable {
+		executable = filepath.Join(workingDir, executable)
+	}
+
+	entry, err := json.Marshal(&benchmark{
+		Name:      filepath.ToSlash(name),
+		Directory: workingDir,
+		Command:   append([]string{executable}, command[1:]...),
+	})
+	if err != nil {
+		return err
+	}
+
+	plan, err := os.OpenFile(planFile, os.O_WRONLY|os.O_APPEND|os.O_CREATE, 0644)
+	if err != nil {
+		return fmt.Errorf("Error opening benchmark plan file: %s", err)
+	}
+	defer plan.Close()
+
+	_, err = plan.Write(append(entry, '\n'))
+	return err
+}
+
+// Ways of finding the benchmarks in the build tree.
+const (
+	autoDiscovery  = "auto"
+	makeDiscovery  = "make"
+	ctestDiscovery = "ctest"
+)
+
+// discoverBenchmarks finds the benchmarks in the build tree below the working directory.
+// With auto discovery, CMake build trees are queried with ctest, and all others with
+// "make benchmark".
+func discoverBenchmarks(self string, workingDir string, discovery string, label string) ([]benchmark, error) {
+	if discovery == autoDiscovery {
+		discovery = makeDiscovery
+		if _, err := os.Stat(filepath.Join(workingDir, "CTestTestfile.cmake")); err == nil {
+			discovery = ctestDiscovery
+		}
+	}
+
+	switch discovery {
+	case makeDiscovery:
+		return discoverMakeBenchmarks(self, workingDir)
+	case ctestDiscovery:
+		return discoverCTestBenchmarks(workingDir, label)
+	}
+	return nil, fmt.Errorf("Unknown benchmark discovery %s, use auto, make or ctest", discovery)
+}
+
+// discoverMakeBenchmarks runs "make benchmark" with benchmarkrunner itself as TESTRUNNER, to
+// collect the command lines of all benchmarks without running them.
+func discoverMakeBenchmarks(self string, workingDir string) ([]benchmark, error) {
+	planFile, err := ioutil.TempFile("", "benchmarkplan")
+	if err != nil {
+		return nil, err
+	}
+	planFile.Close()
+	defer os.Remove(planFile.Name())
+
+	makeCommand := exec.Command("make", "-s", "benchmark", "TESTRUNNER="+self, "TESTARGS=")
+	makeCommand.Dir = workingDir
+	makeCommand.Env = append(os.Environ(), "QT_BENCHMARK_PLAN_FILE="+planFile.Name(), "QT_BENCHMARK_BASE_DIRECTORY="+workingDir)
+	makeCommand.Stdout = os.Stdout
+	makeCommand.Stderr = os.Stderr
+
+	if err := makeCommand.Run(); err != nil {
+		return nil, fmt.Errorf("Error running make benchmark: %s", err)
+	}
+
+	return readBenchmarkPlan(planFile.Name())
+}
+
+func readBenchmarkPlan(planFile string) ([]benchmark, error) {
+	plan, err := os.Open(planFile)
+	if err != nil {
+		return nil, err
+	}
+	defer plan.Close()
+
+	var benchmarks []benchmark
+	scanner := bufio.NewScanner(plan)
+	for scanner.Scan() {
+		var entry benchmark
+		if err := json.Unmarshal(scanner.Bytes(), &entry); err != nil {
+			return nil, fmt.Errorf("Error reading benchmark plan: %s", err)
+		}
+		benchmarks = append(benchmarks, entry)
+	}
+	return benchmarks, scanner.Err()
+}
+
+// ctestInfo is the part of the output of ctest --show-only=json-v1 needed to run the tests.
+type ctestInfo struct {
+	Tests []struct {
+		Name       string
+		Command    []string
+		Properties []struct {
+			Name  string
+			Value json.RawMessage
+		}
+	}
+}
+
+// discoverCTestBenchmarks lists the tests with the given label with ctest, which works
+// for CMake build trees regardless of the generator. The benchmarks are named after the
+// directory they run in, like with "make benchmark", and after the test if the directory
+// is shared.
+func discoverCTestBenchmarks(workingDir string, label string) ([]benchmark, error) {
+	ctest := exec.Command("ctest", "--show-only=json-v1", "-L", label)
+	ctest.Dir = workingDir
+	ctest.Stderr = os.Stderr
+	output, err := ctest.Output()
+	if err != nil {
+		return nil, fmt.Errorf("Error running ctest: %s", err)
+	}
+
+	var info ctestInfo
+	if err := json.Unmarshal(output, &info); err != nil {
+		return nil, fmt.Errorf("Error reading ctest test list: %s", err)
+	}
+
+	var benchmarks []benchmark
+	var testNames []string
+	names := map[string]int{}
+	for _, test := range info.Tests {
+		if len(test.Command) == 0 {
+			continue
+		}
+		directory := filepath.Dir(test.Command[0])
+		for _, property := range test.Properties {
+			if property.Name == "WORKING_DIRECTORY" {
+				json.Unmarshal(property.Value, &directory)
+			}
+		}
+
+		name, err := filepath.Rel(workingDir, directory)
+		if err != nil || name == "." || strings.HasPrefix(name, "..") {
+			name = test.Name
+		}
+		name = filepath.ToSlash(name)
+		names[name]++
+
+		benchmarks = append(benchmarks, benchmark{
+			Name:      name,
+			Directory: directory,
+			Command:   test.Command,
+		})
+		testNames = append(testNames, test.Name)
+	}
+
+	for i := range benchmarks {
+		if names[benchmarks[i].Name] > 1 {
+			benchmarks[i].Name = path.Join(benchmarks[i].Name, testNames[i])
+		}
+	}
+	return benchmarks, nil
+}
@@ -0,0 +1,160 @@
+package main
+
+import (
+	"bufio"
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"strings"
+	"time"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+func governorPath(cpu int) string {
+	return fmt.Sprintf("/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu)
+}
+
+func readGovernor(cpu int) string {
+	governor, err := ioutil.ReadFile(governorPath(cpu))
+	if err != nil {
+		return ""
+	}
+	return strings.TrimSpace(string(governor))
+}
+
+// setCPUGovernor sets the cpufreq scaling governor of the given CPUs, usually to
+// "performance" to avoid frequency scaling during benchmarks. The returned function
+// restores the previous governors.
+func setCPUGovernor(cpus []int, governor string) (restore func(), err error) {
+	previous := map[int]string{}
+	restore = func() {
+		for cpu, previousGovernor := range previous {
+			if err := ioutil.WriteFile(governorPath(cpu), []byte(previousGovernor), 0644); err != nil {
+				fmt.Printf("Error restoring CPU governor of CPU %v: %s\n", cpu, err)
+			}
+		}
+	}
+
+	for _, cpu := range cpus {
+		previousGovernor := readGovernor(cpu)
+		if err := ioutil.WriteFile(governorPath(cpu), []byte(governor), 0644); err != nil {
+			restore()
+			return nil, fmt.Errorf("Error setting CPU governor of CPU %v to %s: %s", cpu, governor, err)
+		}
+		previous[cpu] = previousGovernor
+	}
+	return restore, nil
+}
+
+func systemLoad() (float64, error) {
+	loadavg, err := ioutil.ReadFile("/proc/loadavg")
+	if err != nil {
+		return 0, err
+	}
+	fields := strings.Fields(string(loadavg))
+	if len(fields) == 0 {
+		return 0, fmt.Errorf("Unexpected contents of /proc/loadavg: %s", loadavg)
+	}
+	return strconv.ParseFloat(fields[0], 64)
+}
+
+// waitForLowSystemLoad waits up to a minute for the one minute load average to drop to
+// maxLoad, so that benchmarks don't compete with other work on the machine. If the load
+// stays high the benchmark is run anyway, with a warning.
+func waitForLowSystemLoad(maxLoad float64) {
+	const pollInterval = 5 * time.Second
+	const maxWait = time.Minute
+
+	for waited := time.Duration(0); ; waited += pollInterval {
+		load, err := systemLoad()
+		if err != nil {
+			fmt.Printf("Warning: Cannot determine system load: %s\n", err)
+			return
+		}
+		if load <= maxLoad {
+			return
+		}
+		if waited >= maxWait {
+			fmt.Printf("Warning: System load is %.2f, running benchmark anyway\n", load)
+			return
+		}
+		time.Sleep(pollInterval)
+	}
+}
+
+func cpuModel() string {
+	cpuinfo, err := os.Open("/proc/cpuinfo")
+	if err != nil {
+		return ""
+	}
+	defer cpuinfo.Close()
+
+	scanner := bufio.NewScanner(cpuinfo)
+	for scanner.Scan() {
+		fields := strings.SplitN(scanner.Text(), ":", 2)
+		if len(fields) == 2 && strings.TrimSpace(fields[0]) == "model name" {
+			return strings.TrimSpace(fields[1])
+		}
+	}
+	return ""
+}
+
+// captureEnvironment describes the machine the benchmarks ran on. The Qt build is taken
+// from the first benchmark result in the results directory.
+func captureEnvironment(resultsDir string, options runOptions) *goqtestlib.BenchmarkEnvironment {
+	environment := &goqtestlib.BenchmarkEnvironment{
+		OperatingSystem:    runtime.GOOS,
+		Architecture:       runtime.GOARCH,
+		CPUModel:           cpuModel(),
+		CPUCount:           runtime.NumCPU(),
+		BenchmarkCPUs:      options.cpus,
+		ASLRDisabled:       options.disableASLR,
+		BenchmarkArguments: options.benchmarkArgs,
+		Profiler:           options.profiler,
+	}
+
+	environment.Hostname, _ = os.Hostname()
+
+	if kernel, err := ioutil.ReadFile("/proc/sys/kernel/osrelease"); err == nil {
+		environment.Kernel = strings.TrimSpace(string(kernel))
+	}
+
+	governorCPU := 0
+	if len(options.cpus) > 0 {
+		governorCPU = options.cpus[0]
+	}
+	environment.CPUGovernor = readGovernor(governorCPU)
+
+	filepath.Walk(resultsDir, func(path string, info os.FileInfo, err error) error {
+		if err != nil || info.IsDir() || filepath.Ext(path) != ".xml" || environment.QtBuild != "" {
+			return nil
+		}
+		file, err := os.Open(path)
+		if err != nil {
+			return nil
+		}
+		defer file.Close()
+		// the environment precedes the first test function.
+		parser := goqtestlib.NewTestResultParser(file, goqtestlib.ParseOptions{})
+		if parser.Next() {
+			environment.QtVersion = parser.TestCase().Env.QtVersion
+			environment.QtBuild = parser.TestCase().Env.QtBuild
+		}
+		return nil
+	})
+
+	return environment
+}
+
+func writeEnvironment(resultsDir string, environment *goqtestlib.BenchmarkEnvironment) error {
+	contents, err := json.MarshalIndent(environment, "", "    ")
+	if err != nil {
+		return err
+	}
+	return ioutil.WriteFile(filepath.Join(resultsDir, goqtestlib.BenchmarkEnvironmentFileName), contents, 0644)
+}
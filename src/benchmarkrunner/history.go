@@ -0,0 +1,74 @@
+package main
+
+import (
+	"archive/zip"
+	"fmt"
+	"os"
+	"path/filepath"
+	"time"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// historyRecordFromResults collects all benchmark results in the results directory into
+// a history record for the given commit.
+func historyRecordFromResults(resultsDir string, commit string) (*goqtestlib.HistoryRecord, error) {
+	record := &goqtestlib.HistoryRecord{Commit: commit, Time: time.Now()}
+	err := filepath.Walk(resultsDir, func(filePath string, info os.FileInfo, err error) error {
+		if err != nil || info.IsDir() || filepath.Ext(filePath) != ".xml" {
+			return err
+		}
+		relativePath, err := filepath.Rel(resultsDir, filePath)
+		if err != nil {
+			return err
+		}
+		file, err := os.Open(filePath)
+		if err != nil {
+			return err
+		}
+		defer file.Close()
+
+		testCase, err := goqtestlib.ParseBenchmarkResults(file)
+		if err != nil {
+			return fmt.Errorf("Error reading %s: %s", filePath, err)
+		}
+		name, _ := goqtestlib.SplitRepetitionFileName(filepath.ToSlash(relativePath))
+		record.AddTestCase(name, testCase)
+		return nil
+	})
+	return record, err
+}
+
+// historyRecordFromArchive collects all benchmark results stored in a benchmarkrunner results
+// archive into a history record for the given commit.
+func historyRecordFromArchive(archivePath string, commit string) (*goqtestlib.HistoryRecord, error) {
+	archive, err := zip.OpenReader(archivePath)
+	if err != nil {
+		return nil, fmt.Errorf("Error opening results archive %s: %s", archivePath, err)
+	}
+	defer archive.Close()
+
+	table, err := archivedResultsTable(&archive.Reader)
+	if err != nil {
+		return nil, fmt.Errorf("Error reading results of %s: %s", archivePath, err)
+	}
+
+	record := &goqtestlib.HistoryRecord{Commit: commit, Time: time.Now()}
+	err = table.ForEachTestCase(func(file string, testCase *goqtestlib.ParsedTestResult) error {
+		name, _ := goqtestlib.SplitRepetitionFileName(file)
+		record.AddTestCase(name, testCase)
+		return nil
+	})
+	return record, err
+}
+
+// importArchive appends the results stored in a benchmarkrunner results archive to the
+// history, for the given commit.
+func importArchive(historyFile string, archivePath string, commit string) error {
+	record, err := historyRecordFromArchive(archivePath, commit)
+	if err != nil {
+		return err
+	}
+	history := goqtestlib.ResultHistory{Path: historyFile}
+	return history.Append(record)
+}
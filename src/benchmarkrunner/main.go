@@ -1,131 +1,242 @@
 package main
 
 import (
-	"archive/zip"
 	"flag"
 	"fmt"
-	"io"
 	"io/ioutil"
 	"os"
-	"os/exec"
 	"path/filepath"
-	"strings"
+	"time"
 
 	"code.qt.io/qt/qtqa.git/src/goqtestlib"
 	"github.com/kardianos/osext"
 )
 
-func recordResults(resultsDirectory string, workingDir string) error {
-	os.Unsetenv("TESTRUNNER")
+func collectResults(workingDir string) error {
+	self, err := osext.Executable()
+	if err != nil {
+		return fmt.Errorf("Unable to determine current executable name: %s", err)
+	}
 
-	makeCommand := exec.Command("make", "benchmark")
-	makeCommand.Stdout = os.Stdout
-	makeCommand.Stderr = os.Stderr
-	runner := func(extraArgs []string) error {
-		arguments := strings.Join(extraArgs, " ")
-		benchmarkArgs := os.Getenv("QT_BENCHMARK_ARGS")
-		if benchmarkArgs != "" {
-			arguments = arguments + " " + benchmarkArgs
-		}
+	resultsDir, err := ioutil.TempDir("", "")
+	if err != nil {
+		return err
+	}
+	defer os.RemoveAll(resultsDir)
+
+	os.Setenv("QT_HASH_SEED", "0")
+
+	var outputFileName string
+	var cpuList string
+	options := runOptions{}
+	flag.StringVar(&outputFileName, "output-file", "results.zip", "Write collected benchmark results into specified file")
+	var resume bool
+	flag.BoolVar(&resume, "resume", false, "Continue an interrupted run in -output-file, skipping the benchmarks already in it")
+	flag.IntVar(&options.repetitions, "repetitions", 1, "Run all benchmarks this many times, for statistical comparison with qtestcompare")
+	flag.IntVar(&options.jobs, "jobs", 0, "Run this many benchmarks concurrently. Defaults to the number of CPUs given with -cpus, or 1")
+	flag.StringVar(&cpuList, "cpus", "", "Pin each concurrently running benchmark to one of these CPUs, for example 2-7,10. benchmarkrunner itself runs on the remaining CPUs (Linux only)")
+	var governor string
+	flag.StringVar(&governor, "cpu-governor", "", "Set the cpufreq scaling governor of the benchmark CPUs, for example to performance, while benchmarks are running (Linux only, needs root)")
+	flag.BoolVar(&options.disableASLR, "disable-aslr", false, "Disable address space layout randomization for the benchmarks (Linux only)")
+	flag.Float64Var(&options.maxLoad, "max-load", 0, "Before starting a benchmark, wait up to a minute for the system load to drop below this value (Linux only)")
+	var discovery string
+	var ctestLabel string
+	flag.StringVar(&discovery, "discovery", autoDiscovery, "How to find the benchmarks: make runs \"make benchmark\", ctest lists the tests with the -ctest-label label, auto uses ctest in CMake build directories and make otherwise")
+	flag.StringVar(&ctestLabel, "ctest-label", "benchmark", "The ctest label of the benchmarks")
+	flag.StringVar(&options.profiler, "profile", "", "Run the benchmarks under a profiler, perf or callgrind, and store the profiles in the archive (Linux only)")
+	flag.BoolVar(&options.resourceUsage, "resource-usage", false, "Record the peak memory use (MaxResidentSetSize) and page faults of each benchmark process as additional metrics (Linux only)")
+	var calibrationTarget time.Duration
+	var calibrationArchive string
+	flag.DurationVar(&calibrationTarget, "calibrate", 0, "Calibrate the number of iterations of each wall time benchmark so that one measurement takes this long, for example 200ms. The iteration counts are stored in the archive")
+	flag.StringVar(&calibrationArchive, "calibration-from", "", "Run the benchmarks with the iteration counts stored in this archive, recorded with -calibrate, to measure them the same way")
+	var historyFile string
+	var commit string
+	var archiveToImport string
+	flag.StringVar(&historyFile, "history-file", "", "Append the benchmark results to this result history, for trend detection with qtestcompare -history")
+	flag.StringVar(&commit, "commit", "", "The commit the benchmarks are built from, for the result history")
+	flag.StringVar(&archiveToImport, "import-archive", "", "Instead of running benchmarks, append the results in this archive to the result history")
+	var selectionFile string
+	var mergeInto string
+	flag.StringVar(&selectionFile, "select", "", "Only run the benchmarks listed in this file, one test:function:tag per line, such as written by qtestcompare -suspicious-out")
+	flag.StringVar(&mergeInto, "merge-into", "", "Add the results to this existing archive as further repetitions, instead of writing -output-file")
+	flag.Parse()
+
+	options.benchmarkArgs = flag.Args()
 
-		defer goqtestlib.SetEnvironmentVariableAndRestoreOnExit("TESTARGS", arguments)()
-		return makeCommand.Run()
+	if historyFile != "" && commit == "" {
+		return fmt.Errorf("The result history needs to know the commit the results belong to, use -commit")
 	}
 
-	name, err := filepath.Rel(os.Getenv("QT_BENCHMARK_BASE_DIRECTORY"), workingDir)
-	if err != nil {
-		return fmt.Errorf("Could not determine relative directory: %s", err)
+	if archiveToImport != "" {
+		if historyFile == "" {
+			return fmt.Errorf("-import-archive needs a result history, use -history-file")
+		}
+		return importArchive(historyFile, archiveToImport, commit)
 	}
-	if name == "." {
-		name = "testcase"
+
+	if cpuList != "" {
+		if options.cpus, err = parseCPUList(cpuList); err != nil {
+			return err
+		}
+		if err := keepAwayFromCPUs(options.cpus); err != nil {
+			return err
+		}
 	}
 
-	repetitions := 0
-	result, err := goqtestlib.GenerateTestResult(name, resultsDirectory, repetitions, runner)
-	if err != nil {
+	if err := checkProfiler(options.profiler); err != nil {
 		return err
 	}
+	if options.profiler != "" && (calibrationTarget > 0 || calibrationArchive != "") {
+		return fmt.Errorf("Calibrated benchmarks cannot be profiled, as they may need several runs of each executable")
+	}
 
-	return os.Rename(result.PathToResultsXML, filepath.Join(resultsDirectory, name+".xml"))
-}
-
-func archiveResults(resultsDir string, outputFile io.Writer) error {
-	archiver := zip.NewWriter(outputFile)
-	defer archiver.Close()
+	if options.profiler != "" && options.resourceUsage {
+		return fmt.Errorf("The resource usage of profiled benchmarks would include the profiler, -resource-usage cannot be combined with -profile")
+	}
 
-	return filepath.Walk(resultsDir, func(path string, info os.FileInfo, err error) error {
-		if info == nil || info.IsDir() {
-			return nil
+	if options.jobs <= 0 {
+		options.jobs = 1
+		if len(options.cpus) > 0 {
+			options.jobs = len(options.cpus)
 		}
+	}
+	if len(options.cpus) > 0 && options.jobs > len(options.cpus) {
+		return fmt.Errorf("Cannot run %v benchmarks concurrently on %v CPUs", options.jobs, len(options.cpus))
+	}
+
+	benchmarks, err := discoverBenchmarks(self, workingDir, discovery, ctestLabel)
+	if err != nil {
+		return err
+	}
 
-		relativePath, err := filepath.Rel(resultsDir, path)
+	if selectionFile != "" {
+		selection, err := readBenchmarkSelection(selectionFile)
 		if err != nil {
 			return err
 		}
+		benchmarks = selectBenchmarks(benchmarks, selection)
+	}
 
-		sourceFile, err := os.Open(path)
+	if governor != "" {
+		governorCPUs := options.cpus
+		if len(governorCPUs) == 0 {
+			if governorCPUs, err = onlineCPUs(); err != nil {
+				return err
+			}
+		}
+		restoreGovernor, err := setCPUGovernor(governorCPUs, governor)
 		if err != nil {
 			return err
 		}
-		defer sourceFile.Close()
+		defer restoreGovernor()
+	}
 
-		header, err := zip.FileInfoHeader(info)
-		if err != nil {
+	if mergeInto == "" {
+		if options.archive, err = createIncrementalArchive(outputFileName, resume); err != nil {
 			return err
 		}
-		header.Name = relativePath
+		resultsDir = options.archive.dir
+	}
 
-		file, err := archiver.CreateHeader(header)
-		if err != nil {
+	if calibrationArchive != "" {
+		if options.calibration, err = readCalibration(calibrationArchive); err != nil {
 			return err
 		}
-
-		n, err := io.Copy(file, sourceFile)
-		if n != info.Size() {
-			return fmt.Errorf("Incorrect number of bytes written to archive for %s: Wrote %v expected %v", path, n, info.Size())
+	} else if options.archive != nil && options.archive.hasFile(goqtestlib.BenchmarkCalibrationFileName) {
+		// a resumed run continues with the iteration counts it started with.
+		if options.calibration, err = readCalibrationFile(filepath.Join(resultsDir, goqtestlib.BenchmarkCalibrationFileName)); err != nil {
+			return err
+		}
+	} else if calibrationTarget > 0 {
+		if options.calibration, err = calibrateBenchmarks(benchmarks, calibrationTarget, options); err != nil {
+			return err
 		}
-		return err
-	})
-}
-
-func collectResults(workingDir string) error {
-	self, err := osext.Executable()
-	if err != nil {
-		return fmt.Errorf("Unable to determine current executable name: %s", err)
 	}
-
-	resultsDir, err := ioutil.TempDir("", "")
-	if err != nil {
-		return err
+	if options.calibration != nil {
+		if options.uncalibrated, err = findUncalibratedFunctions(benchmarks, options.calibration); err != nil {
+			return err
+		}
+	}
+	if options.calibration != nil && options.archive != nil {
+		if err := writeCalibration(resultsDir, options.calibration); err != nil {
+			return err
+		}
 	}
-	defer os.RemoveAll(resultsDir)
 
-	os.Setenv("TESTRUNNER", self)
-	os.Setenv("QT_BENCHMARK_RECORDING_DIRECTORY", resultsDir)
-	os.Setenv("QT_BENCHMARK_BASE_DIRECTORY", workingDir)
-	os.Setenv("QT_HASH_SEED", "0")
+	fmt.Printf("Running %v benchmarks, %v at a time\n", len(benchmarks), options.jobs)
 
-	var outputFileName string
-	flag.StringVar(&outputFileName, "output-file", "results.zip", "Write collected benchmark results into specified file")
-	flag.Parse()
+	runErr := runBenchmarks(benchmarks, resultsDir, options)
+
+	if mergeInto != "" {
+		if runErr != nil {
+			return runErr
+		}
+		if historyFile != "" {
+			record, err := historyRecordFromResults(resultsDir, commit)
+			if err != nil {
+				return err
+			}
+			history := goqtestlib.ResultHistory{Path: historyFile}
+			if err := history.Append(record); err != nil {
+				return err
+			}
+		}
+		return mergeResultsIntoArchive(resultsDir, mergeInto)
+	}
 
-	os.Setenv("QT_BENCHMARK_ARGS", strings.Join(flag.Args(), " "))
+	// a resumed run keeps the description of the environment it started in.
+	if !options.archive.hasFile(goqtestlib.BenchmarkEnvironmentFileName) {
+		if err := writeEnvironment(resultsDir, captureEnvironment(resultsDir, options)); err != nil {
+			return fmt.Errorf("Error writing environment information: %s", err)
+		}
+	}
 
-	makeCommand := exec.Command("make", "benchmark")
-	makeCommand.Stdout = os.Stdout
-	makeCommand.Stderr = os.Stderr
+	if err := options.archive.finish(); err != nil {
+		return fmt.Errorf("Error writing %s: %s", outputFileName, err)
+	}
 
-	if err := makeCommand.Run(); err != nil {
-		return fmt.Errorf("Error running make benchmark: %s", err)
+	if failures := options.archive.failures(); len(failures) > 0 {
+		fmt.Printf("%v benchmark runs failed and are listed in the manifest of %s. Run again with -resume to retry them.\n", len(failures), outputFileName)
 	}
 
-	outputFile, err := os.Create(outputFileName)
-	if err != nil {
-		return fmt.Errorf("Error creating output file: %s", err)
+	if historyFile != "" {
+		if runErr != nil {
+			return fmt.Errorf("%s, not adding incomplete results to the history", runErr)
+		}
+		record, err := historyRecordFromArchive(outputFileName, commit)
+		if err != nil {
+			return err
+		}
+		history := goqtestlib.ResultHistory{Path: historyFile}
+		if err := history.Append(record); err != nil {
+			return err
+		}
 	}
-	defer outputFile.Close()
 
-	return archiveResults(resultsDir, outputFile)
+	return runErr
+}
+
+// keepAwayFromCPUs restricts benchmarkrunner, and with it the processes it starts for
+// discovering benchmarks, to the CPUs that are not reserved for running benchmarks.
+func keepAwayFromCPUs(benchmarkCPUs []int) error {
+	allCPUs, err := onlineCPUs()
+	if err != nil {
+		return err
+	}
+	reserved := map[int]bool{}
+	for _, cpu := range benchmarkCPUs {
+		reserved[cpu] = true
+	}
+	var remaining []int
+	for _, cpu := range allCPUs {
+		if !reserved[cpu] {
+			remaining = append(remaining, cpu)
+		}
+	}
+	if len(remaining) == 0 {
+		return nil
+	}
+	return restrictProcessToCPUs(remaining)
 }
 
 func appMain() error {
@@ -134,8 +245,20 @@ func appMain() error {
 		return fmt.Errorf("Error determining current working directory: %s", err)
 	}
 
-	if os.Getenv("QT_BENCHMARK_RECORDING_DIRECTORY") != "" {
-		return recordResults(os.Getenv("QT_BENCHMARK_RECORDING_DIRECTORY"), workingDir)
+	if os.Getenv("QT_BENCHMARK_PLAN_FILE") != "" {
+		return planBenchmark(os.Getenv("QT_BENCHMARK_PLAN_FILE"), workingDir, os.Args[1:])
+	}
+
+	if len(os.Args) > 1 {
+		switch os.Args[1] {
+		case "bisect":
+			return bisect(workingDir, os.Args[2:])
+		case "bisect-step":
+			if len(os.Args) != 3 {
+				os.Exit(bisectAbort)
+			}
+			os.Exit(bisectStep(os.Args[2]))
+		}
 	}
 
 	return collectResults(workingDir)
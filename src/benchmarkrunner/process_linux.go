@@ -0,0 +1,138 @@
+package main
+
+import (
+	"fmt"
+	"io/ioutil"
+	"os"
+	"os/exec"
+	"runtime"
+	"strconv"
+	"syscall"
+	"unsafe"
+)
+
+// cpuMask is a cpu_set_t as used by sched_setaffinity, large enough for maxCPUs CPUs.
+type cpuMask [maxCPUs / 64]uint64
+
+func maskForCPUs(cpus []int) (mask cpuMask) {
+	for _, cpu := range cpus {
+		mask[cpu/64] |= 1 << uint(cpu%64)
+	}
+	return mask
+}
+
+func getThreadAffinity(tid int) (mask cpuMask, err error) {
+	_, _, errno := syscall.RawSyscall(syscall.SYS_SCHED_GETAFFINITY, uintptr(tid), unsafe.Sizeof(mask), uintptr(unsafe.Pointer(&mask)))
+	if errno != 0 {
+		return mask, errno
+	}
+	return mask, nil
+}
+
+func setThreadAffinity(tid int, mask cpuMask) error {
+	_, _, errno := syscall.RawSyscall(syscall.SYS_SCHED_SETAFFINITY, uintptr(tid), unsafe.Sizeof(mask), uintptr(unsafe.Pointer(&mask)))
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// addrNoRandomize is the ADDR_NO_RANDOMIZE personality flag from linux/personality.h.
+const addrNoRandomize = 0x0040000
+
+func personality(persona uintptr) (uintptr, error) {
+	previous, _, errno := syscall.RawSyscall(syscall.SYS_PERSONALITY, persona, 0, 0)
+	if errno != 0 {
+		return 0, errno
+	}
+	return previous, nil
+}
+
+// startProcess starts the command with the given setup. If setup.cpu is not negative, the
+// process is pinned to that CPU. With setup.disableASLR, address space layout randomization
+// is turned off for the process. Both the affinity and the personality are properties of the
+// calling thread that are inherited by the child, so they are applied to a locked OS thread
+// right before forking. This way the benchmark never runs without them.
+func startProcess(cmd *exec.Cmd, setup processSetup) error {
+	if setup.cpu < 0 && !setup.disableASLR {
+		return cmd.Start()
+	}
+
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	if setup.cpu >= 0 {
+		previousMask, err := getThreadAffinity(0)
+		if err != nil {
+			return fmt.Errorf("Error reading CPU affinity: %s", err)
+		}
+		if err := setThreadAffinity(0, maskForCPUs([]int{setup.cpu})); err != nil {
+			return fmt.Errorf("Error pinning benchmark to CPU %v: %s", setup.cpu, err)
+		}
+		defer setThreadAffinity(0, previousMask)
+	}
+
+	if setup.disableASLR {
+		// 0xffffffff queries the current personality without changing it.
+		previousPersona, err := personality(0xffffffff)
+		if err != nil {
+			return fmt.Errorf("Error reading process personality: %s", err)
+		}
+		if _, err := personality(previousPersona | addrNoRandomize); err != nil {
+			return fmt.Errorf("Error disabling address space layout randomization: %s", err)
+		}
+		defer personality(previousPersona)
+	}
+
+	return cmd.Start()
+}
+
+// restrictProcessToCPUs pins all threads of benchmarkrunner to the given CPUs, to keep it
+// away from the CPUs the benchmarks run on. Threads created later inherit the affinity.
+func restrictProcessToCPUs(cpus []int) error {
+	tasks, err := ioutil.ReadDir("/proc/self/task")
+	if err != nil {
+		return err
+	}
+	mask := maskForCPUs(cpus)
+	for _, task := range tasks {
+		tid, err := strconv.Atoi(task.Name())
+		if err != nil {
+			continue
+		}
+		if err := setThreadAffinity(tid, mask); err != nil {
+			return fmt.Errorf("Error setting CPU affinity of thread %v: %s", tid, err)
+		}
+	}
+	return nil
+}
+
+// onlineCPUs returns the CPUs benchmarkrunner is currently allowed to run on.
+func onlineCPUs() ([]int, error) {
+	mask, err := getThreadAffinity(0)
+	if err != nil {
+		return nil, err
+	}
+	var cpus []int
+	for cpu := 0; cpu < len(mask)*64; cpu++ {
+		if mask[cpu/64]&(1<<uint(cpu%64)) != 0 {
+			cpus = append(cpus, cpu)
+		}
+	}
+	return cpus, nil
+}
+
+// processResourceUsage returns the resources used by an exited process and the children it
+// waited for.
+func processResourceUsage(state *os.ProcessState) (resourceUsage, error) {
+	rusage, ok := state.SysUsage().(*syscall.Rusage)
+	if !ok {
+		return resourceUsage{}, fmt.Errorf("No resource usage available for process %v", state.Pid())
+	}
+	return resourceUsage{
+		// ru_maxrss is in kilobytes on Linux.
+		maxResidentSetBytes: int64(rusage.Maxrss) * 1024,
+		minorPageFaults:     int64(rusage.Minflt),
+		majorPageFaults:     int64(rusage.Majflt),
+	}, nil
+}
@@ -0,0 +1,34 @@
+//go:build !linux
+// +build !linux
+
+package main
+
+import (
+	"errors"
+	"os"
+	"os/exec"
+)
+
+var errAffinityNotSupported = errors.New("Pinning benchmarks to CPUs is only supported on Linux")
+
+func startProcess(cmd *exec.Cmd, setup processSetup) error {
+	if setup.cpu >= 0 {
+		return errAffinityNotSupported
+	}
+	if setup.disableASLR {
+		return errors.New("Disabling address space layout randomization is only supported on Linux")
+	}
+	return cmd.Start()
+}
+
+func restrictProcessToCPUs(cpus []int) error {
+	return errAffinityNotSupported
+}
+
+func onlineCPUs() ([]int, error) {
+	return nil, errAffinityNotSupported
+}
+
+func processResourceUsage(state *os.ProcessState) (resourceUsage, error) {
+	return resourceUsage{}, errors.New("Recording the resource usage of benchmarks is only supported on Linux")
+}
@@ -0,0 +1,81 @@
+package main
+
+import (
+	"bytes"
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// Profilers benchmarks can be run under with -profile.
+const (
+	perfProfiler      = "perf"
+	callgrindProfiler = "callgrind"
+)
+
+// profileKinds are the kinds of profiles stored next to the results of a benchmark run.
+var profileKinds = []string{"perf.data", "folded", "callgrind.out"}
+
+func checkProfiler(profiler string) error {
+	switch profiler {
+	case "":
+		return nil
+	case perfProfiler:
+		_, err := exec.LookPath("perf")
+		return err
+	case callgrindProfiler:
+		_, err := exec.LookPath("valgrind")
+		return err
+	}
+	return fmt.Errorf("Unknown profiler %s, use perf or callgrind", profiler)
+}
+
+// profiledCommand returns the command line that runs the benchmark under the profiler, which
+// writes its raw profile into the results directory, next to the results of the repetition.
+func (task *benchmarkTask) profiledCommand(resultsDir string, profiler string, command []string) []string {
+	var profilerCommand []string
+	switch profiler {
+	case perfProfiler:
+		profilerCommand = []string{"perf", "record", "-g", "-q", "-o", task.profilePath(resultsDir, "perf.data"), "--"}
+	case callgrindProfiler:
+		profilerCommand = []string{"valgrind", "--tool=callgrind", "--quiet", "--callgrind-out-file=" + task.profilePath(resultsDir, "callgrind.out"), "--"}
+	default:
+		return command
+	}
+	return append(profilerCommand, command...)
+}
+
+func (task *benchmarkTask) profilePath(resultsDir string, kind string) string {
+	return filepath.Join(resultsDir, goqtestlib.ProfileFileName(task.benchmark.Name, task.repetition, kind))
+}
+
+// foldProfile turns the perf profile of the task into folded stacks, for rendering it as
+// flame graph. Callgrind profiles only record callers and callees, not complete stacks, and
+// are kept for tools like kcachegrind only.
+func (task *benchmarkTask) foldProfile(resultsDir string, profiler string) error {
+	if profiler != perfProfiler {
+		return nil
+	}
+
+	var script bytes.Buffer
+	cmd := exec.Command("perf", "script", "-i", task.profilePath(resultsDir, "perf.data"))
+	cmd.Stdout = &script
+	if err := cmd.Run(); err != nil {
+		return fmt.Errorf("Error running perf script: %s", err)
+	}
+
+	stacks, err := goqtestlib.FoldPerfScript(&script)
+	if err != nil {
+		return err
+	}
+
+	folded, err := os.Create(task.profilePath(resultsDir, "folded"))
+	if err != nil {
+		return err
+	}
+	defer folded.Close()
+	return stacks.Write(folded)
+}
@@ -0,0 +1,49 @@
+package main
+
+import (
+	"os"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// resourceUsage holds the resources used by the benchmark processes of a run, as reported by
+// the kernel when each process exits. The peak memory use is the largest of all processes,
+// the page faults add up.
+type resourceUsage struct {
+	maxResidentSetBytes int64
+	minorPageFaults     int64
+	majorPageFaults     int64
+}
+
+// add accounts for the resources used by an exited process.
+func (usage *resourceUsage) add(state *os.ProcessState) error {
+	processUsage, err := processResourceUsage(state)
+	if err != nil {
+		return err
+	}
+	if processUsage.maxResidentSetBytes > usage.maxResidentSetBytes {
+		usage.maxResidentSetBytes = processUsage.maxResidentSetBytes
+	}
+	usage.minorPageFaults += processUsage.minorPageFaults
+	usage.majorPageFaults += processUsage.majorPageFaults
+	return nil
+}
+
+// testFunction returns the resource usage as benchmark results of a test function, so that
+// qtestcompare compares them like the metrics reported by QTestLib.
+func (usage *resourceUsage) testFunction() goqtestlib.TestFunction {
+	result := func(metric string, value int64) goqtestlib.BenchmarkResult {
+		return goqtestlib.BenchmarkResult{Metric: metric, Value: float64(value), Iterations: 1}
+	}
+	return goqtestlib.TestFunction{
+		Name: goqtestlib.ResourceUsageFunctionName,
+		Incidents: []goqtestlib.Incident{
+			{IncidentHeader: goqtestlib.IncidentHeader{Type: "pass"}},
+		},
+		BenchmarkResults: []goqtestlib.BenchmarkResult{
+			result("MaxResidentSetSize", usage.maxResidentSetBytes),
+			result("MinorPageFaults", usage.minorPageFaults),
+			result("MajorPageFaults", usage.majorPageFaults),
+		},
+	}
+}
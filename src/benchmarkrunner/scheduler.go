@@ -0,0 +1,222 @@
+package main
+
+import (
+	"bytes"
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// runOptions control how the discovered benchmarks are executed.
+type runOptions struct {
+	repetitions int
+	jobs        int
+	cpus        []int
+	disableASLR bool
+	maxLoad     float64
+	profiler    string
+	calibration *goqtestlib.BenchmarkCalibration
+	// uncalibrated holds the selected functions of each calibrated benchmark that have no
+	// iteration counts in the calibration.
+	uncalibrated  map[string][]string
+	benchmarkArgs []string
+	// resourceUsage adds the peak memory use and page faults of the benchmark processes to
+	// the results.
+	resourceUsage bool
+	// archive records each run as soon as it finishes, if set. The results directory is its
+	// staging directory then.
+	archive *incrementalArchive
+}
+
+// processSetup describes how a benchmark process is set up before it starts running.
+type processSetup struct {
+	// cpu is the CPU the process is pinned to, or -1.
+	cpu         int
+	disableASLR bool
+}
+
+// maxCPUs is the number of CPUs benchmarks can be pinned to, the size of a cpu_set_t.
+const maxCPUs = 1024
+
+// parseCPUList parses a list of CPUs in the format used by taskset -c, such as "2-5,8".
+func parseCPUList(list string) ([]int, error) {
+	var cpus []int
+	for _, part := range strings.Split(list, ",") {
+		bounds := strings.SplitN(part, "-", 2)
+		first, err := strconv.Atoi(bounds[0])
+		if err != nil {
+			return nil, fmt.Errorf("Invalid CPU list %s: %s", list, err)
+		}
+		last := first
+		if len(bounds) == 2 {
+			if last, err = strconv.Atoi(bounds[1]); err != nil {
+				return nil, fmt.Errorf("Invalid CPU list %s: %s", list, err)
+			}
+		}
+		if first > last {
+			return nil, fmt.Errorf("Invalid CPU list %s: range %s is reversed", list, part)
+		}
+		if last >= maxCPUs {
+			return nil, fmt.Errorf("Invalid CPU list %s: CPU numbers must be below %v", list, maxCPUs)
+		}
+		for cpu := first; cpu <= last; cpu++ {
+			cpus = append(cpus, cpu)
+		}
+	}
+	sort.Ints(cpus)
+	return cpus, nil
+}
+
+type benchmarkTask struct {
+	benchmark  benchmark
+	repetition int
+}
+
+// run executes one repetition of the benchmark in a process set up according to setup and
+// moves its results into the results directory. The output of the benchmark is returned so
+// that the output of concurrently running benchmarks doesn't interleave. If a profiler is
+// given, the benchmark runs under it and the profile is stored next to the results. Calibrated
+// benchmarks may need several runs of the executable, whose results are merged. The resource
+// usage of the benchmark processes is added to the results as an extra test function.
+func (task *benchmarkTask) run(resultsDir string, setup processSetup, options *runOptions) ([]byte, error) {
+	var output bytes.Buffer
+	resultsPath := filepath.Join(resultsDir, goqtestlib.RepetitionFileName(task.benchmark.Name, task.repetition))
+
+	var results []*goqtestlib.TestResult
+	var usage resourceUsage
+	defer func() {
+		for _, result := range results {
+			os.Remove(result.PathToResultsXML)
+		}
+	}()
+
+	for _, invocationArgs := range options.invocations(task.benchmark) {
+		runner := func(extraArgs []string) error {
+			command := append([]string{}, task.benchmark.Command...)
+			command = append(command, extraArgs...)
+			command = append(command, options.benchmarkArgs...)
+			command = append(command, invocationArgs...)
+
+			command = task.profiledCommand(resultsDir, options.profiler, command)
+			cmd := exec.Command(command[0], command[1:]...)
+			cmd.Dir = task.benchmark.Directory
+			cmd.Stdout = &output
+			cmd.Stderr = &output
+
+			if err := startProcess(cmd, setup); err != nil {
+				return err
+			}
+			err := cmd.Wait()
+			if options.resourceUsage {
+				if usageErr := usage.add(cmd.ProcessState); usageErr != nil {
+					return usageErr
+				}
+			}
+			return err
+		}
+
+		repetitions := 0
+		result, err := goqtestlib.GenerateTestResult(task.benchmark.Name, resultsDir, repetitions, runner)
+		if err != nil {
+			return output.Bytes(), err
+		}
+		results = append(results, result)
+	}
+
+	if len(results) == 1 && !options.resourceUsage {
+		if err := os.Rename(results[0].PathToResultsXML, resultsPath); err != nil {
+			return output.Bytes(), err
+		}
+		return output.Bytes(), task.foldProfile(resultsDir, options.profiler)
+	}
+
+	var parsed []*goqtestlib.ParsedTestResult
+	for _, result := range results {
+		testCase, err := result.Parse()
+		if err != nil {
+			return output.Bytes(), err
+		}
+		parsed = append(parsed, testCase)
+	}
+	merged := mergeTestResults(parsed)
+	if options.resourceUsage {
+		merged.Functions = append(merged.Functions, usage.testFunction())
+	}
+	return output.Bytes(), writeTestResult(resultsPath, merged)
+}
+
+// runBenchmarks runs all repetitions of all benchmarks with up to options.jobs benchmarks
+// running concurrently. If CPUs are given, each concurrently running benchmark is pinned to a
+// CPU of its own. All repetitions of one round are run before starting the next round, so
+// that slow drifts of the machine state affect all benchmarks alike. A failing benchmark
+// doesn't stop the others; all failures are reported in the returned error.
+func runBenchmarks(benchmarks []benchmark, resultsDir string, options runOptions) error {
+	tasks := make(chan benchmarkTask)
+	var outputMutex sync.Mutex
+	var failures []string
+	var running int32
+
+	var workers sync.WaitGroup
+	for worker := 0; worker < options.jobs; worker++ {
+		cpu := -1
+		if len(options.cpus) > 0 {
+			cpu = options.cpus[worker%len(options.cpus)]
+		}
+
+		workers.Add(1)
+		setup := processSetup{cpu: cpu, disableASLR: options.disableASLR}
+
+		go func(setup processSetup) {
+			defer workers.Done()
+			for task := range tasks {
+				if options.maxLoad > 0 {
+					// the benchmarks we are running ourselves add to the load.
+					waitForLowSystemLoad(options.maxLoad + float64(atomic.LoadInt32(&running)))
+				}
+
+				atomic.AddInt32(&running, 1)
+				output, err := task.run(resultsDir, setup, &options)
+				atomic.AddInt32(&running, -1)
+
+				if options.archive != nil {
+					if archiveErr := options.archive.addRun(task, err); archiveErr != nil && err == nil {
+						err = fmt.Errorf("Error adding results to archive: %s", archiveErr)
+					}
+				}
+
+				outputMutex.Lock()
+				fmt.Printf("=== %s (repetition %v) ===\n", task.benchmark.Name, task.repetition)
+				os.Stdout.Write(output)
+				if err != nil {
+					fmt.Printf("%s failed: %s\n", task.benchmark.Name, err)
+					failures = append(failures, fmt.Sprintf("%s (repetition %v)", task.benchmark.Name, task.repetition))
+				}
+				outputMutex.Unlock()
+			}
+		}(setup)
+	}
+
+	for repetition := 1; repetition <= options.repetitions; repetition++ {
+		for _, benchmark := range benchmarks {
+			if options.archive != nil && options.archive.isCompleted(goqtestlib.RepetitionFileName(benchmark.Name, repetition)) {
+				continue
+			}
+			tasks <- benchmarkTask{benchmark, repetition}
+		}
+	}
+	close(tasks)
+	workers.Wait()
+
+	if len(failures) > 0 {
+		return fmt.Errorf("Error running benchmarks: %s", strings.Join(failures, ", "))
+	}
+	return nil
+}
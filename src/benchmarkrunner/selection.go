@@ -0,0 +1,61 @@
+package main
+
+import (
+	"bufio"
+	"fmt"
+	"os"
+	"strings"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// readBenchmarkSelection reads a file with one benchmark per line, as test:function or
+// test:function:tag, such as written by qtestcompare -suspicious-out. It returns the
+// QTestLib function arguments selecting the benchmarks, per test.
+func readBenchmarkSelection(path string) (map[string][]string, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return nil, fmt.Errorf("Error opening benchmark selection: %s", err)
+	}
+	defer file.Close()
+
+	selection := map[string][]string{}
+	scanner := bufio.NewScanner(file)
+	for scanner.Scan() {
+		line := strings.TrimSpace(scanner.Text())
+		if line == "" || strings.HasPrefix(line, "#") {
+			continue
+		}
+		id, err := goqtestlib.ParseBenchmarkID(line)
+		if err != nil {
+			return nil, err
+		}
+		selector := id.Function
+		if id.Tag != "" {
+			selector += ":" + id.Tag
+		}
+		selection[id.Test] = append(selection[id.Test], selector)
+	}
+	return selection, scanner.Err()
+}
+
+// selectBenchmarks returns the benchmarks that are part of the selection, restricted to the
+// selected functions and data tags. The resource usage recorded with -resource-usage belongs
+// to the whole process, so selecting it runs all functions of the test.
+func selectBenchmarks(benchmarks []benchmark, selection map[string][]string) []benchmark {
+	var selected []benchmark
+	for _, b := range benchmarks {
+		functions, ok := selection[b.Name]
+		if !ok {
+			continue
+		}
+		b.Functions = functions
+		for _, function := range functions {
+			if function == goqtestlib.ResourceUsageFunctionName {
+				b.Functions = nil
+			}
+		}
+		selected = append(selected, b)
+	}
+	return selected
+}
@@ -0,0 +1,184 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"fmt"
+	"regexp"
+	"strconv"
+	"strings"
+)
+
+// BenchmarkEnvironmentFileName is the name of the file in a benchmark results archive that
+// describes the environment the benchmarks were run in.
+const BenchmarkEnvironmentFileName = "environment.json"
+
+// BenchmarkCalibrationFileName is the name of the file in a benchmark results archive that
+// holds the iteration counts the benchmarks were run with.
+const BenchmarkCalibrationFileName = "calibration.json"
+
+// BenchmarkCalibration holds the number of iterations each benchmark is run with, so that one
+// measurement takes about TargetMilliseconds. Iterations maps the name of a test to the
+// function or function:tag selectors of its benchmarks and their iteration counts. A count of
+// 0 means that the benchmark could not be calibrated and runs with QTestLib's defaults.
+type BenchmarkCalibration struct {
+	TargetMilliseconds int
+	Iterations         map[string]map[string]int
+}
+
+// ResourceUsageFunctionName is the name of the test function benchmarkrunner adds to the
+// results of benchmarks run with -resource-usage. Its benchmark results hold the resources
+// used by the whole benchmark process, such as its peak memory use, rather than by a single
+// test function.
+const ResourceUsageFunctionName = "processResourceUsage"
+
+// BenchmarkEnvironment describes the machine and configuration benchmark results were
+// recorded with. Results recorded in different environments are not comparable.
+type BenchmarkEnvironment struct {
+	Hostname           string
+	OperatingSystem    string
+	Architecture       string
+	Kernel             string
+	CPUModel           string
+	CPUCount           int
+	CPUGovernor        string
+	BenchmarkCPUs      []int
+	ASLRDisabled       bool
+	QtVersion          string
+	QtBuild            string
+	BenchmarkArguments []string
+	Profiler           string
+}
+
+// Differences returns a human readable description of each property in which the two
+// environments differ in a way that affects benchmark results. The host name is not
+// considered, as identically configured machines are expected to produce comparable results.
+func (e *BenchmarkEnvironment) Differences(other *BenchmarkEnvironment) []string {
+	var differences []string
+	compare := func(property string, value string, otherValue string) {
+		if value != otherValue {
+			differences = append(differences, fmt.Sprintf("%s: %q vs %q", property, value, otherValue))
+		}
+	}
+	compare("Operating system", e.OperatingSystem, other.OperatingSystem)
+	compare("Architecture", e.Architecture, other.Architecture)
+	compare("Kernel", e.Kernel, other.Kernel)
+	compare("CPU model", e.CPUModel, other.CPUModel)
+	compare("CPU count", strconv.Itoa(e.CPUCount), strconv.Itoa(other.CPUCount))
+	compare("CPU governor", e.CPUGovernor, other.CPUGovernor)
+	compare("ASLR disabled", strconv.FormatBool(e.ASLRDisabled), strconv.FormatBool(other.ASLRDisabled))
+	compare("Qt build", e.QtBuild, other.QtBuild)
+	compare("Benchmark arguments", strings.Join(e.BenchmarkArguments, " "), strings.Join(other.BenchmarkArguments, " "))
+	compare("Profiler", e.Profiler, other.Profiler)
+	return differences
+}
+
+var repetitionSuffix = regexp.MustCompile(`\.rep([0-9]+)\.xml$`)
+
+// RepetitionFileName returns the file name under which the results of a repeated benchmark
+// run are stored in a results archive. The first repetition is stored as name.xml, so that
+// archives without repetitions keep their layout, and the following ones as name.repN.xml.
+func RepetitionFileName(name string, repetition int) string {
+	if repetition <= 1 {
+		return name + ".xml"
+	}
+	return fmt.Sprintf("%s.rep%d.xml", name, repetition)
+}
+
+// SplitRepetitionFileName is the inverse of RepetitionFileName. It returns the benchmark name
+// without the .xml extension and the 1-based repetition number.
+func SplitRepetitionFileName(fileName string) (name string, repetition int) {
+	if match := repetitionSuffix.FindStringSubmatch(fileName); match != nil {
+		repetition, _ = strconv.Atoi(match[1])
+		return strings.TrimSuffix(fileName, match[0]), repetition
+	}
+	return strings.TrimSuffix(fileName, ".xml"), 1
+}
+
+// metricUnits maps the metric names QTestLib uses in BenchmarkResult elements to the
+// units they are measured in. See QTest::benchmarkMetricName() in qtbase.
+var metricUnits = map[string]string{
+	"FramesPerSecond":      "fps",
+	"BitsPerSecond":        "bits/s",
+	"BytesPerSecond":       "bytes/s",
+	"WalltimeMilliseconds": "ms",
+	"WalltimeNanoseconds":  "ns",
+	"CPUTicks":             "ticks",
+	"InstructionReads":     "instr",
+	"Events":               "events",
+	"BytesAllocated":       "bytes",
+	"MaxResidentSetSize":   "bytes",
+	"CPUMigrations":        "migrations",
+	"CPUCycles":            "cycles",
+	"RefCPUCycles":         "cycles",
+	"BusCycles":            "cycles",
+	"StalledCycles":        "cycles",
+	"Instructions":         "instr",
+	"BranchInstructions":   "branches",
+	"BranchMisses":         "misses",
+	"CacheReferences":      "refs",
+	"CacheReads":           "reads",
+	"CacheWrites":          "writes",
+	"CachePrefetches":      "prefetches",
+	"CacheMisses":          "misses",
+	"CacheReadMisses":      "misses",
+	"CacheWriteMisses":     "misses",
+	"CachePrefetchMisses":  "misses",
+	"ContextSwitches":      "switches",
+	"PageFaults":           "faults",
+	"MinorPageFaults":      "faults",
+	"MajorPageFaults":      "faults",
+	"AlignmentFaults":      "faults",
+	"EmulationFaults":      "faults",
+}
+
+// MetricUnit returns a short unit suffix for displaying values of the given QTestLib
+// benchmark metric. Unknown metrics are displayed with their name as unit.
+func MetricUnit(metric string) string {
+	if unit, ok := metricUnits[metric]; ok {
+		return unit
+	}
+	return metric
+}
+
+// MetricHigherIsBetter returns true for throughput metrics, where an increase of the value
+// is an improvement rather than a regression.
+func MetricHigherIsBetter(metric string) bool {
+	return metric == "FramesPerSecond" || metric == "BitsPerSecond" || metric == "BytesPerSecond"
+}
@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"testing"
+)
+
+func TestRepetitionFileName(t *testing.T) {
+	for _, testCase := range []struct {
+		name       string
+		repetition int
+		fileName   string
+	}{
+		{"corelib/tools/qstring", 1, "corelib/tools/qstring.xml"},
+		{"corelib/tools/qstring", 2, "corelib/tools/qstring.rep2.xml"},
+		{"testcase", 12, "testcase.rep12.xml"},
+	} {
+		if fileName := RepetitionFileName(testCase.name, testCase.repetition); fileName != testCase.fileName {
+			t.Errorf("Unexpected file name for %s repetition %v. Got %s", testCase.name, testCase.repetition, fileName)
+		}
+		name, repetition := SplitRepetitionFileName(testCase.fileName)
+		if name != testCase.name || repetition != testCase.repetition {
+			t.Errorf("Unexpected split of %s. Got %s and %v", testCase.fileName, name, repetition)
+		}
+	}
+}
+
+func TestBenchmarkEnvironmentDifferences(t *testing.T) {
+	old := &BenchmarkEnvironment{Hostname: "bench1", CPUModel: "Xeon", CPUCount: 64, CPUGovernor: "performance", QtBuild: "Qt 6.5.0"}
+	new := *old
+	new.Hostname = "bench2"
+
+	if differences := old.Differences(&new); len(differences) != 0 {
+		t.Errorf("Host name should not be considered a difference. Got %v", differences)
+	}
+
+	new.CPUGovernor = "powersave"
+	differences := old.Differences(&new)
+	if len(differences) != 1 || differences[0] != `CPU governor: "performance" vs "powersave"` {
+		t.Errorf("Unexpected differences %v", differences)
+	}
+}
@@ -0,0 +1,333 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bufio"
+	"encoding/json"
+	"fmt"
+	"math"
+	"math/rand"
+	"os"
+	"sort"
+	"strings"
+	"time"
+)
+
+// BenchmarkID identifies a single benchmark: a data row of a test function in a test. Its
+// string form is test:function:tag, where the tag is omitted for functions without data.
+type BenchmarkID struct {
+	Test     string
+	Function string
+	Tag      string
+}
+
+func (id BenchmarkID) String() string {
+	if id.Tag == "" {
+		return id.Test + ":" + id.Function
+	}
+	return id.Test + ":" + id.Function + ":" + id.Tag
+}
+
+// ParseBenchmarkID is the inverse of BenchmarkID.String. Tags may contain colons.
+func ParseBenchmarkID(id string) (BenchmarkID, error) {
+	parts := strings.SplitN(id, ":", 3)
+	if len(parts) < 2 || parts[0] == "" || parts[1] == "" {
+		return BenchmarkID{}, fmt.Errorf("Invalid benchmark %q, expected test:function or test:function:tag", id)
+	}
+	result := BenchmarkID{Test: parts[0], Function: parts[1]}
+	if len(parts) == 3 {
+		result.Tag = parts[2]
+	}
+	return result, nil
+}
+
+// HistoryResult holds all values measured for one metric of one benchmark in a run.
+type HistoryResult struct {
+	Benchmark string
+	Metric    string
+	Values    []float64
+}
+
+// HistoryRecord holds the results of one benchmark run, such as a nightly run, of a commit.
+type HistoryRecord struct {
+	Commit  string
+	Time    time.Time
+	Results []HistoryResult
+}
+
+// AddTestCase adds all benchmark results of a test case to the record. Repeated runs of the
+// same test add further values to the existing results.
+func (record *HistoryRecord) AddTestCase(test string, testCase *ParsedTestResult) {
+	index := map[string]int{}
+	for i, result := range record.Results {
+		index[result.Benchmark+"\x00"+result.Metric] = i
+	}
+	for _, function := range testCase.Functions {
+		for _, benchmarkResult := range function.BenchmarkResults {
+			benchmark := BenchmarkID{test, function.Name, benchmarkResult.Tag}.String()
+			key := benchmark + "\x00" + benchmarkResult.Metric
+			i, ok := index[key]
+			if !ok {
+				i = len(record.Results)
+				index[key] = i
+				record.Results = append(record.Results, HistoryResult{Benchmark: benchmark, Metric: benchmarkResult.Metric})
+			}
+			record.Results[i].Values = append(record.Results[i].Values, benchmarkResult.Value)
+		}
+	}
+}
+
+// ResultHistory is an append-only store of benchmark runs, kept in a file with one JSON
+// encoded HistoryRecord per line. Records are expected to be appended in commit order.
+//
+// A plain file keeps goqtestlib free of cgo and database dependencies, and appending a line
+// never rewrites the records already stored. ResultsTable is not used, as it describes a
+// single archive and cannot be appended to.
+type ResultHistory struct {
+	Path string
+}
+
+// Append adds the record to the end of the history.
+func (history *ResultHistory) Append(record *HistoryRecord) error {
+	line, err := json.Marshal(record)
+	if err != nil {
+		return err
+	}
+	file, err := os.OpenFile(history.Path, os.O_WRONLY|os.O_APPEND|os.O_CREATE, 0644)
+	if err != nil {
+		return fmt.Errorf("Error opening result history %s: %s", history.Path, err)
+	}
+	if _, err := file.Write(append(line, '\n')); err != nil {
+		file.Close()
+		return fmt.Errorf("Error appending to result history %s: %s", history.Path, err)
+	}
+	if err := file.Sync(); err != nil {
+		file.Close()
+		return err
+	}
+	return file.Close()
+}
+
+// Records reads all records from the history, in the order they were appended.
+func (history *ResultHistory) Records() ([]HistoryRecord, error) {
+	file, err := os.Open(history.Path)
+	if err != nil {
+		return nil, fmt.Errorf("Error opening result history %s: %s", history.Path, err)
+	}
+	defer file.Close()
+
+	var records []HistoryRecord
+	scanner := bufio.NewScanner(file)
+	scanner.Buffer(nil, 256*1024*1024)
+	for line := 1; scanner.Scan(); line++ {
+		var record HistoryRecord
+		if err := json.Unmarshal(scanner.Bytes(), &record); err != nil {
+			return nil, fmt.Errorf("Error reading result history %s:%v: %s", history.Path, line, err)
+		}
+		records = append(records, record)
+	}
+	return records, scanner.Err()
+}
+
+// HistorySeries is the series of results of one metric of one benchmark over the history.
+// Values holds the median of all values measured for the corresponding commit.
+type HistorySeries struct {
+	Benchmark string
+	Metric    string
+	Commits   []string
+	Values    []float64
+}
+
+// Series splits the records into one series per benchmark and metric, sorted by benchmark
+// and metric.
+func Series(records []HistoryRecord) []HistorySeries {
+	index := map[string]int{}
+	var series []HistorySeries
+	for _, record := range records {
+		for _, result := range record.Results {
+			if len(result.Values) == 0 {
+				continue
+			}
+			key := result.Benchmark + "\x00" + result.Metric
+			i, ok := index[key]
+			if !ok {
+				i = len(series)
+				index[key] = i
+				series = append(series, HistorySeries{Benchmark: result.Benchmark, Metric: result.Metric})
+			}
+			series[i].Commits = append(series[i].Commits, record.Commit)
+			series[i].Values = append(series[i].Values, Median(result.Values))
+		}
+	}
+	sort.Slice(series, func(i, j int) bool {
+		if series[i].Benchmark != series[j].Benchmark {
+			return series[i].Benchmark < series[j].Benchmark
+		}
+		return series[i].Metric < series[j].Metric
+	})
+	return series
+}
+
+// ChangePointOptions control DetectChangePoints.
+type ChangePointOptions struct {
+	// Alpha is the significance level of the permutation test for each change point.
+	Alpha float64
+	// Threshold is the minimum change of the medians before and after a change point, in percent.
+	Threshold float64
+	// MinimumSegment is the minimum number of values on either side of a change point.
+	MinimumSegment int
+	// Permutations is the number of random permutations used to estimate the p-value.
+	Permutations int
+}
+
+// DefaultChangePointOptions returns the options used when nothing else is specified.
+func DefaultChangePointOptions() ChangePointOptions {
+	return ChangePointOptions{
+		Alpha:          0.01,
+		Threshold:      2.0,
+		MinimumSegment: 3,
+		Permutations:   500,
+	}
+}
+
+// ChangePoint describes a step change in a series. Index is the index of the first value
+// after the change.
+type ChangePoint struct {
+	Index  int
+	Before float64
+	After  float64
+	// Change is the relative change from the median before to the median after, in percent.
+	Change float64
+	PValue float64
+}
+
+// DetectChangePoints finds the step changes in a series of values using binary segmentation.
+// Each segment is split where a rank based CUSUM statistic (the standardized Wilcoxon rank sum
+// of the values before the split) is largest. The split is accepted if a permutation test
+// finds it significant and the medians of the two sides differ by at least the threshold.
+// Working on ranks makes the detection robust against single outliers, as in E-Divisive.
+// The change points are returned sorted by index.
+func DetectChangePoints(values []float64, options ChangePointOptions) []ChangePoint {
+	random := rand.New(rand.NewSource(1))
+	var changePoints []ChangePoint
+
+	var segment func(begin int, end int)
+	segment = func(begin int, end int) {
+		if end-begin < 2*options.MinimumSegment {
+			return
+		}
+		ranks := rankValues(values[begin:end])
+		split, statistic := maximumRankStatistic(ranks, options.MinimumSegment)
+
+		exceeding := 0
+		permuted := append([]float64(nil), ranks...)
+		for i := 0; i < options.Permutations; i++ {
+			random.Shuffle(len(permuted), func(a, b int) { permuted[a], permuted[b] = permuted[b], permuted[a] })
+			if _, permutedStatistic := maximumRankStatistic(permuted, options.MinimumSegment); permutedStatistic >= statistic {
+				exceeding++
+			}
+		}
+		pValue := float64(exceeding+1) / float64(options.Permutations+1)
+		if pValue >= options.Alpha {
+			return
+		}
+
+		changePoint := ChangePoint{
+			Index:  begin + split,
+			Before: Median(values[begin : begin+split]),
+			After:  Median(values[begin+split : end]),
+			PValue: pValue,
+		}
+		changePoint.Change = relativeChange(changePoint.Before, changePoint.After)
+		if math.Abs(changePoint.Change) < options.Threshold {
+			return
+		}
+
+		changePoints = append(changePoints, changePoint)
+		segment(begin, begin+split)
+		segment(begin+split, end)
+	}
+	segment(0, len(values))
+
+	sort.Slice(changePoints, func(i, j int) bool { return changePoints[i].Index < changePoints[j].Index })
+	return changePoints
+}
+
+// rankValues returns the 1-based ranks of the values, with ties getting their average rank.
+func rankValues(values []float64) []float64 {
+	order := make([]int, len(values))
+	for i := range order {
+		order[i] = i
+	}
+	sort.Slice(order, func(i, j int) bool { return values[order[i]] < values[order[j]] })
+
+	ranks := make([]float64, len(values))
+	for i := 0; i < len(order); {
+		j := i
+		for j < len(order) && values[order[j]] == values[order[i]] {
+			j++
+		}
+		for k := i; k < j; k++ {
+			ranks[order[k]] = float64(i+j+1) / 2
+		}
+		i = j
+	}
+	return ranks
+}
+
+// maximumRankStatistic returns the split with the largest standardized rank sum difference
+// between the ranks before and after it, along with that statistic.
+func maximumRankStatistic(ranks []float64, minimumSegment int) (split int, statistic float64) {
+	n := float64(len(ranks))
+	sum := 0.0
+	for i := 0; i < minimumSegment-1; i++ {
+		sum += ranks[i]
+	}
+	for i := minimumSegment; i <= len(ranks)-minimumSegment; i++ {
+		sum += ranks[i-1]
+		before := float64(i)
+		expected := before * (n + 1) / 2
+		deviation := math.Sqrt(before * (n - before) * (n + 1) / 12)
+		if value := math.Abs(sum-expected) / deviation; value > statistic {
+			split, statistic = i, value
+		}
+	}
+	return split, statistic
+}
@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"io/ioutil"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+func TestBenchmarkID(t *testing.T) {
+	for _, id := range []string{"corelib/tools/qstring:append", "corelib/tools/qstring:append:with:colons"} {
+		parsed, err := ParseBenchmarkID(id)
+		if err != nil {
+			t.Fatalf("Error parsing %s: %s", id, err)
+		}
+		if parsed.String() != id {
+			t.Errorf("Benchmark id %s did not survive parsing. Got %s", id, parsed.String())
+		}
+	}
+	if parsed, _ := ParseBenchmarkID("test:function:tag:x"); parsed.Tag != "tag:x" {
+		t.Errorf("Unexpected tag %s", parsed.Tag)
+	}
+	if _, err := ParseBenchmarkID("justatest"); err == nil {
+		t.Errorf("Benchmark ids without function should be rejected")
+	}
+}
+
+func TestResultHistory(t *testing.T) {
+	dir, err := ioutil.TempDir("", "history")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	history := ResultHistory{Path: filepath.Join(dir, "history.jsonl")}
+
+	testCase := &ParsedTestResult{
+		Name: "tst_QString",
+		Functions: []TestFunction{
+			{Name: "append", BenchmarkResults: []BenchmarkResult{{Metric: "WalltimeMilliseconds", Tag: "small", Value: 10}}},
+		},
+	}
+
+	for i, commit := range []string{"aaa", "bbb"} {
+		record := &HistoryRecord{Commit: commit}
+		record.AddTestCase("corelib/tools/qstring", testCase)
+		testCase.Functions[0].BenchmarkResults[0].Value += 1
+		record.AddTestCase("corelib/tools/qstring", testCase)
+		if len(record.Results) != 1 || len(record.Results[0].Values) != 2 {
+			t.Fatalf("Repeated runs should be merged into one result. Got %v", record.Results)
+		}
+		if err := history.Append(record); err != nil {
+			t.Fatalf("Error appending record %v: %s", i, err)
+		}
+	}
+
+	records, err := history.Records()
+	if err != nil {
+		t.Fatalf("Error reading history: %s", err)
+	}
+	if len(records) != 2 || records[1].Commit != "bbb" {
+		t.Fatalf("Unexpected records %v", records)
+	}
+
+	series := Series(records)
+	if len(series) != 1 {
+		t.Fatalf("Unexpected number of series %v", len(series))
+	}
+	if series[0].Benchmark != "corelib/tools/qstring:append:small" || series[0].Metric != "WalltimeMilliseconds" {
+		t.Errorf("Unexpected series %v", series[0])
+	}
+	if len(series[0].Values) != 2 || series[0].Values[0] != 10.5 || series[0].Values[1] != 11.5 {
+		t.Errorf("Unexpected series values %v", series[0].Values)
+	}
+}
+
+func TestDetectChangePoints(t *testing.T) {
+	random := rand.New(rand.NewSource(42))
+	noise := func(level float64) float64 { return level * (1 + 0.01*random.NormFloat64()) }
+
+	var values []float64
+	for i := 0; i < 20; i++ {
+		values = append(values, noise(100))
+	}
+	for i := 0; i < 20; i++ {
+		values = append(values, noise(110))
+	}
+	// a single outlier must not be reported as a change
+	values[5] = 300
+
+	changePoints := DetectChangePoints(values, DefaultChangePointOptions())
+	if len(changePoints) != 1 {
+		t.Fatalf("Expected exactly one change point. Got %v", changePoints)
+	}
+	if changePoints[0].Index != 20 {
+		t.Errorf("Change point detected at the wrong index %v", changePoints[0].Index)
+	}
+	if changePoints[0].Change < 8 || changePoints[0].Change > 12 {
+		t.Errorf("Unexpected change %v", changePoints[0].Change)
+	}
+
+	var flat []float64
+	for i := 0; i < 40; i++ {
+		flat = append(flat, noise(100))
+	}
+	if changePoints := DetectChangePoints(flat, DefaultChangePointOptions()); len(changePoints) != 0 {
+		t.Errorf("Noise should not produce change points. Got %v", changePoints)
+	}
+}
@@ -0,0 +1,368 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"encoding/xml"
+	"fmt"
+	"io"
+	"strconv"
+)
+
+// ParseOptions control which parts of the test functions a TestResultParser decodes. The
+// parts that are not needed are skipped without decoding them.
+type ParseOptions struct {
+	Incidents        bool
+	Messages         bool
+	BenchmarkResults bool
+}
+
+// DefaultParseOptions returns the options that decode everything except the messages, which
+// make up most of the output of tests with a lot of qDebug() output.
+func DefaultParseOptions() ParseOptions {
+	return ParseOptions{Incidents: true, BenchmarkResults: true}
+}
+
+// TestResultParser decodes QTestLib XML output as a stream, one test function at a time, so
+// that large outputs don't need to be kept in memory. Strings that repeat throughout the
+// output, such as file names, metric names and data tags, are shared between the functions.
+// The output is read as raw tokens, which saves the namespace handling of xml.Decoder.Token
+// and the reflection of xml.Unmarshal. Use it like a bufio.Scanner:
+//
+//	parser := NewTestResultParser(reader, DefaultParseOptions())
+//	for parser.Next() {
+//		function := parser.Function()
+//		...
+//	}
+//	if err := parser.Err(); err != nil {
+//		...
+//	}
+type TestResultParser struct {
+	decoder  *xml.Decoder
+	options  ParseOptions
+	strings  map[string]string
+	testCase ParsedTestResult
+	function TestFunction
+	// depth is the number of open elements around the current position.
+	depth int
+	found bool
+	done  bool
+	err   error
+}
+
+// NewTestResultParser returns a parser reading QTestLib XML output from the reader.
+func NewTestResultParser(reader io.Reader, options ParseOptions) *TestResultParser {
+	return &TestResultParser{
+		decoder: xml.NewDecoder(reader),
+		options: options,
+		strings: map[string]string{},
+	}
+}
+
+// Next decodes the next test function. It returns false at the end of the output or when an
+// error occurred, which Err returns then.
+func (parser *TestResultParser) Next() bool {
+	if parser.done {
+		return false
+	}
+	for {
+		token, err := parser.decoder.RawToken()
+		if err == io.EOF {
+			if !parser.found {
+				return parser.fail(fmt.Errorf("No TestCase element found in testlib xml output"))
+			}
+			if parser.depth > 0 {
+				return parser.fail(fmt.Errorf("Error decoding testlib xml output: %s", io.ErrUnexpectedEOF))
+			}
+			parser.done = true
+			return false
+		}
+		if err != nil {
+			return parser.fail(fmt.Errorf("Error decoding testlib xml output: %s", err))
+		}
+
+		switch element := token.(type) {
+		case xml.EndElement:
+			parser.depth--
+		case xml.StartElement:
+			parser.depth++
+			switch element.Name.Local {
+			case "TestCase":
+				parser.found = true
+				parser.testCase.XMLName = element.Name
+				parser.testCase.Name = attributeValue(element, "name")
+			case "Environment":
+				if err := parser.environment(); err != nil {
+					return parser.fail(fmt.Errorf("Error decoding testlib environment: %s", err))
+				}
+			case "Duration":
+				parser.testCase.Duration = parser.duration(element)
+				if err := parser.skip(); err != nil {
+					return parser.fail(fmt.Errorf("Error decoding testlib xml output: %s", err))
+				}
+			case "TestFunction":
+				parser.function = TestFunction{Name: parser.intern(attributeValue(element, "name"))}
+				if err := parser.testFunction(); err != nil {
+					return parser.fail(fmt.Errorf("Error decoding test function %s: %s", parser.function.Name, err))
+				}
+				return true
+			default:
+				if err := parser.skip(); err != nil {
+					return parser.fail(fmt.Errorf("Error decoding testlib xml output: %s", err))
+				}
+			}
+		}
+	}
+}
+
+// Function returns the test function decoded by the last call to Next. It is replaced by the
+// next test function, so callers need to copy what they want to keep.
+func (parser *TestResultParser) Function() *TestFunction {
+	return &parser.function
+}
+
+// TestCase returns the name and environment of the test case, and after the last function
+// also its duration. Its Functions are not filled in.
+func (parser *TestResultParser) TestCase() *ParsedTestResult {
+	return &parser.testCase
+}
+
+// Err returns the error that made Next return false, if any.
+func (parser *TestResultParser) Err() error {
+	return parser.err
+}
+
+func (parser *TestResultParser) fail(err error) bool {
+	parser.err = err
+	parser.done = true
+	return false
+}
+
+func (parser *TestResultParser) intern(value string) string {
+	if interned, ok := parser.strings[value]; ok {
+		return interned
+	}
+	parser.strings[value] = value
+	return value
+}
+
+// children calls handle for each child element of the element just started, up to its end.
+// handle has to read the child element completely, for example with skip or text.
+func (parser *TestResultParser) children(handle func(child xml.StartElement) error) error {
+	for {
+		token, err := parser.decoder.RawToken()
+		if err == io.EOF {
+			return io.ErrUnexpectedEOF
+		}
+		if err != nil {
+			return err
+		}
+		switch element := token.(type) {
+		case xml.EndElement:
+			parser.depth--
+			return nil
+		case xml.StartElement:
+			parser.depth++
+			if err := handle(element); err != nil {
+				return err
+			}
+		}
+	}
+}
+
+// skip skips the rest of the element just started.
+func (parser *TestResultParser) skip() error {
+	return parser.children(func(xml.StartElement) error { return parser.skip() })
+}
+
+// text returns the character data of the element just started.
+func (parser *TestResultParser) text() (string, error) {
+	var text []byte
+	for {
+		token, err := parser.decoder.RawToken()
+		if err == io.EOF {
+			return "", io.ErrUnexpectedEOF
+		}
+		if err != nil {
+			return "", err
+		}
+		switch element := token.(type) {
+		case xml.CharData:
+			text = append(text, element...)
+		case xml.EndElement:
+			parser.depth--
+			return string(text), nil
+		case xml.StartElement:
+			parser.depth++
+			if err := parser.skip(); err != nil {
+				return "", err
+			}
+		}
+	}
+}
+
+func (parser *TestResultParser) environment() error {
+	return parser.children(func(child xml.StartElement) error {
+		value, err := parser.text()
+		switch child.Name.Local {
+		case "QtVersion":
+			parser.testCase.Env.QtVersion = value
+		case "QtBuild":
+			parser.testCase.Env.QtBuild = value
+		case "QTestVersion":
+			parser.testCase.Env.QTestVersion = value
+		}
+		return err
+	})
+}
+
+func (parser *TestResultParser) duration(element xml.StartElement) Duration {
+	msecs, _ := strconv.ParseFloat(attributeValue(element, "msecs"), 64)
+	return Duration{Msecs: msecs}
+}
+
+// testFunction decodes the children of a TestFunction element that the options select.
+func (parser *TestResultParser) testFunction() error {
+	function := &parser.function
+	return parser.children(func(child xml.StartElement) error {
+		switch {
+		case child.Name.Local == "Incident" && parser.options.Incidents:
+			incident, err := parser.incident(child)
+			function.Incidents = append(function.Incidents, incident)
+			return err
+		case child.Name.Local == "Message" && parser.options.Messages:
+			message, err := parser.message(child)
+			function.Messages = append(function.Messages, message)
+			return err
+		case child.Name.Local == "BenchmarkResult" && parser.options.BenchmarkResults:
+			result, err := parser.benchmarkResult(child)
+			if err != nil {
+				return err
+			}
+			function.BenchmarkResults = append(function.BenchmarkResults, result)
+		case child.Name.Local == "Duration":
+			function.Duration = parser.duration(child)
+		}
+		return parser.skip()
+	})
+}
+
+func (parser *TestResultParser) incidentHeader(element xml.StartElement) IncidentHeader {
+	header := IncidentHeader{}
+	for _, attribute := range element.Attr {
+		switch attribute.Name.Local {
+		case "type":
+			header.Type = parser.intern(attribute.Value)
+		case "file":
+			header.File = parser.intern(attribute.Value)
+		case "line":
+			header.Line, _ = strconv.Atoi(attribute.Value)
+		}
+	}
+	return header
+}
+
+func (parser *TestResultParser) incident(element xml.StartElement) (Incident, error) {
+	incident := Incident{IncidentHeader: parser.incidentHeader(element)}
+	err := parser.children(func(child xml.StartElement) error {
+		switch child.Name.Local {
+		case "DataTag":
+			tag, err := parser.text()
+			incident.DataTag = parser.intern(tag)
+			return err
+		case "Description":
+			description, err := parser.text()
+			incident.Description = description
+			return err
+		}
+		return parser.skip()
+	})
+	return incident, err
+}
+
+func (parser *TestResultParser) message(element xml.StartElement) (Message, error) {
+	message := Message{IncidentHeader: parser.incidentHeader(element)}
+	err := parser.children(func(child xml.StartElement) error {
+		if child.Name.Local != "Description" {
+			return parser.skip()
+		}
+		description, err := parser.text()
+		message.Description = description
+		return err
+	})
+	return message, err
+}
+
+// benchmarkResult decodes the attributes of a BenchmarkResult element.
+func (parser *TestResultParser) benchmarkResult(element xml.StartElement) (BenchmarkResult, error) {
+	result := BenchmarkResult{}
+	for _, attribute := range element.Attr {
+		var err error
+		switch attribute.Name.Local {
+		case "metric":
+			result.Metric = parser.intern(attribute.Value)
+		case "tag":
+			result.Tag = parser.intern(attribute.Value)
+		case "value":
+			result.Value, err = strconv.ParseFloat(attribute.Value, 64)
+		case "iterations":
+			result.Iterations, err = strconv.Atoi(attribute.Value)
+		}
+		if err != nil {
+			return result, err
+		}
+	}
+	return result, nil
+}
+
+// ParseTestResult reads QTestLib XML output from the reader and returns the test case with
+// the parts of its test functions selected by the options.
+func ParseTestResult(reader io.Reader, options ParseOptions) (*ParsedTestResult, error) {
+	parser := NewTestResultParser(reader, options)
+	var functions []TestFunction
+	for parser.Next() {
+		functions = append(functions, *parser.Function())
+	}
+	if err := parser.Err(); err != nil {
+		return nil, err
+	}
+	testCase := *parser.TestCase()
+	testCase.Functions = functions
+	return &testCase, nil
+}
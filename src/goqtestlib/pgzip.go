@@ -0,0 +1,187 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"sync"
+)
+
+// DefaultGzipBlockSize is the amount of uncompressed data a ParallelGzipWriter compresses in
+// one piece.
+const DefaultGzipBlockSize = 1 << 20
+
+// ParallelGzipWriter is a gzip writer that compresses blocks of its input on several
+// goroutines at the same time. Each block is written as a gzip member of its own. Concatenated
+// members are a valid gzip stream, which gzip, tar and Go's gzip.Reader decompress as one, at
+// the cost of a few bytes per block and of back references across blocks.
+type ParallelGzipWriter struct {
+	destination io.Writer
+	level       int
+	blockSize   int
+	buffer      []byte
+	// queue holds the blocks being compressed, in order, and limits their number.
+	queue    chan chan []byte
+	finished chan struct{}
+	written  bool
+
+	compressors sync.Pool
+
+	mutex sync.Mutex
+	err   error
+}
+
+// NewParallelGzipWriter returns a writer compressing into destination with the given gzip
+// level, with up to concurrency blocks of blockSize bytes being compressed at once.
+func NewParallelGzipWriter(destination io.Writer, level int, concurrency int, blockSize int) (*ParallelGzipWriter, error) {
+	if _, err := gzip.NewWriterLevel(nil, level); err != nil {
+		return nil, err
+	}
+	if concurrency < 1 {
+		concurrency = 1
+	}
+	if blockSize <= 0 {
+		blockSize = DefaultGzipBlockSize
+	}
+
+	w := &ParallelGzipWriter{
+		destination: destination,
+		level:       level,
+		blockSize:   blockSize,
+		queue:       make(chan chan []byte, concurrency),
+		finished:    make(chan struct{}),
+	}
+	go w.writeBlocks()
+	return w, nil
+}
+
+// writeBlocks writes the compressed blocks to the destination in the order they were queued.
+func (w *ParallelGzipWriter) writeBlocks() {
+	defer close(w.finished)
+	for block := range w.queue {
+		compressed := <-block
+		if w.error() != nil {
+			continue
+		}
+		if _, err := w.destination.Write(compressed); err != nil {
+			w.setError(err)
+		}
+	}
+}
+
+func (w *ParallelGzipWriter) error() error {
+	w.mutex.Lock()
+	defer w.mutex.Unlock()
+	return w.err
+}
+
+func (w *ParallelGzipWriter) setError(err error) {
+	w.mutex.Lock()
+	defer w.mutex.Unlock()
+	if w.err == nil {
+		w.err = err
+	}
+}
+
+// Write buffers the data and queues full blocks for compression.
+func (w *ParallelGzipWriter) Write(data []byte) (int, error) {
+	if err := w.error(); err != nil {
+		return 0, err
+	}
+	written := len(data)
+	for len(data) > 0 {
+		if w.buffer == nil {
+			w.buffer = make([]byte, 0, w.blockSize)
+		}
+		n := w.blockSize - len(w.buffer)
+		if n > len(data) {
+			n = len(data)
+		}
+		w.buffer = append(w.buffer, data[:n]...)
+		data = data[n:]
+		if len(w.buffer) == w.blockSize {
+			w.flushBlock()
+		}
+	}
+	return written, nil
+}
+
+// flushBlock queues the buffered data for compression. It blocks while as many blocks as
+// allowed are being compressed.
+func (w *ParallelGzipWriter) flushBlock() {
+	block := make(chan []byte, 1)
+	w.queue <- block
+	go w.compress(w.buffer, block)
+	w.buffer = nil
+	w.written = true
+}
+
+func (w *ParallelGzipWriter) compress(data []byte, block chan<- []byte) {
+	var compressed bytes.Buffer
+	compressor, _ := w.compressors.Get().(*gzip.Writer)
+	if compressor == nil {
+		compressor, _ = gzip.NewWriterLevel(&compressed, w.level)
+	} else {
+		compressor.Reset(&compressed)
+	}
+
+	_, err := compressor.Write(data)
+	if err == nil {
+		err = compressor.Close()
+	}
+	if err != nil {
+		w.setError(err)
+	}
+	w.compressors.Put(compressor)
+	block <- compressed.Bytes()
+}
+
+// Close compresses the remaining data and waits for all blocks to be written. It does not
+// close the destination.
+func (w *ParallelGzipWriter) Close() error {
+	if len(w.buffer) > 0 || !w.written {
+		// an empty stream still needs one member to be valid gzip.
+		w.flushBlock()
+	}
+	close(w.queue)
+	<-w.finished
+	return w.error()
+}
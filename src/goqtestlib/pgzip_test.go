@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bytes"
+	"compress/gzip"
+	"fmt"
+	"io/ioutil"
+	"testing"
+)
+
+func TestParallelGzipWriter(t *testing.T) {
+	var input bytes.Buffer
+	for i := 0; i < 10000; i++ {
+		fmt.Fprintf(&input, "<Incident type=\"pass\" file=\"\" line=\"%v\" />\n", i)
+	}
+
+	for _, blockSize := range []int{1000, 65536, input.Len(), 2 * input.Len()} {
+		var compressed bytes.Buffer
+		writer, err := NewParallelGzipWriter(&compressed, gzip.BestSpeed, 4, blockSize)
+		if err != nil {
+			t.Fatalf("Error creating writer: %s", err)
+		}
+		// write in pieces that don't line up with the blocks.
+		for data := input.Bytes(); len(data) > 0; {
+			n := 777
+			if n > len(data) {
+				n = len(data)
+			}
+			if _, err := writer.Write(data[:n]); err != nil {
+				t.Fatalf("Error writing: %s", err)
+			}
+			data = data[n:]
+		}
+		if err := writer.Close(); err != nil {
+			t.Fatalf("Error closing writer: %s", err)
+		}
+
+		reader, err := gzip.NewReader(&compressed)
+		if err != nil {
+			t.Fatalf("Error reading compressed data with block size %v: %s", blockSize, err)
+		}
+		output, err := ioutil.ReadAll(reader)
+		if err != nil {
+			t.Fatalf("Error decompressing with block size %v: %s", blockSize, err)
+		}
+		if !bytes.Equal(output, input.Bytes()) {
+			t.Errorf("Decompressed data differs with block size %v", blockSize)
+		}
+	}
+}
+
+func TestParallelGzipWriterEmpty(t *testing.T) {
+	var compressed bytes.Buffer
+	writer, err := NewParallelGzipWriter(&compressed, gzip.DefaultCompression, 2, 0)
+	if err != nil {
+		t.Fatalf("Error creating writer: %s", err)
+	}
+	if err := writer.Close(); err != nil {
+		t.Fatalf("Error closing writer: %s", err)
+	}
+
+	reader, err := gzip.NewReader(&compressed)
+	if err != nil {
+		t.Fatalf("Empty stream is not valid gzip: %s", err)
+	}
+	if output, err := ioutil.ReadAll(reader); err != nil || len(output) != 0 {
+		t.Errorf("Unexpected contents of empty stream %q, %v", output, err)
+	}
+}
@@ -0,0 +1,231 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"math"
+	"path"
+	"regexp"
+	"sort"
+	"strconv"
+	"strings"
+)
+
+// ProfileFileName returns the file name under which a profile of the given kind, such as
+// "perf.data" or "folded", of a benchmark repetition is stored in a results archive, next
+// to the results of the repetition.
+func ProfileFileName(name string, repetition int, kind string) string {
+	return strings.TrimSuffix(RepetitionFileName(name, repetition), ".xml") + "." + kind
+}
+
+// SplitProfileFileName is the inverse of ProfileFileName for profiles of the given kind. ok
+// is false if the file is not a profile of that kind.
+func SplitProfileFileName(fileName string, kind string) (name string, repetition int, ok bool) {
+	if !strings.HasSuffix(fileName, "."+kind) {
+		return "", 0, false
+	}
+	name, repetition = SplitRepetitionFileName(strings.TrimSuffix(fileName, "."+kind) + ".xml")
+	return name, repetition, true
+}
+
+// FoldedStacks maps call stacks, with the frames from the outermost to the innermost joined
+// by semicolons, to the number of samples taken in them. This is the input format of
+// flamegraph.pl.
+type FoldedStacks map[string]float64
+
+var perfFrameOffset = regexp.MustCompile(`\+0x[0-9a-f]+$`)
+
+// foldPerfFrame turns a stack frame line of perf script, "address symbol+offset (dso)", into
+// the name of the function. Frames without symbols are named after their binary.
+func foldPerfFrame(line string) string {
+	fields := strings.SplitN(strings.TrimSpace(line), " ", 2)
+	if len(fields) < 2 {
+		return "[unknown]"
+	}
+	frame := fields[1]
+	dso := ""
+	if open := strings.LastIndex(frame, " ("); open >= 0 && strings.HasSuffix(frame, ")") {
+		dso = frame[open+2 : len(frame)-1]
+		frame = frame[:open]
+	}
+	frame = perfFrameOffset.ReplaceAllString(frame, "")
+	if frame == "[unknown]" && dso != "" && dso != "[unknown]" {
+		frame = "[" + path.Base(dso) + "]"
+	}
+	// semicolons separate frames in the folded format.
+	return strings.Replace(frame, ";", ":", -1)
+}
+
+// FoldPerfScript reads the output of perf script for a profile recorded with call graphs
+// (perf record -g) and folds it into one entry per distinct call stack, rooted at the name
+// of the process, like stackcollapse-perf.pl does.
+func FoldPerfScript(input io.Reader) (FoldedStacks, error) {
+	stacks := FoldedStacks{}
+	var process string
+	var frames []string
+
+	flush := func() {
+		if process == "" {
+			return
+		}
+		stack := []string{process}
+		for i := len(frames) - 1; i >= 0; i-- {
+			stack = append(stack, frames[i])
+		}
+		stacks[strings.Join(stack, ";")]++
+		process = ""
+		frames = frames[:0]
+	}
+
+	scanner := bufio.NewScanner(input)
+	scanner.Buffer(make([]byte, 64*1024), 1024*1024)
+	for scanner.Scan() {
+		line := scanner.Text()
+		switch {
+		case strings.TrimSpace(line) == "":
+			flush()
+		case strings.HasPrefix(line, "#"):
+		case line[0] == ' ' || line[0] == '\t':
+			if process != "" {
+				frames = append(frames, foldPerfFrame(line))
+			}
+		default:
+			// a sample header: "command pid [cpu] time: period event:"
+			flush()
+			if fields := strings.Fields(line); len(fields) > 0 {
+				process = strings.Replace(fields[0], ";", ":", -1)
+			}
+		}
+	}
+	flush()
+	return stacks, scanner.Err()
+}
+
+// Read reads stacks in the folded format, adding them to the existing ones.
+func (stacks FoldedStacks) Read(input io.Reader) error {
+	scanner := bufio.NewScanner(input)
+	scanner.Buffer(make([]byte, 64*1024), 1024*1024)
+	for scanner.Scan() {
+		line := strings.TrimSpace(scanner.Text())
+		if line == "" {
+			continue
+		}
+		separator := strings.LastIndex(line, " ")
+		if separator < 0 {
+			return fmt.Errorf("Invalid folded stack line %q", line)
+		}
+		count, err := strconv.ParseFloat(line[separator+1:], 64)
+		if err != nil {
+			return fmt.Errorf("Invalid sample count in folded stack line %q", line)
+		}
+		stacks[line[:separator]] += count
+	}
+	return scanner.Err()
+}
+
+func (stacks FoldedStacks) sortedKeys() []string {
+	keys := make([]string, 0, len(stacks))
+	for stack := range stacks {
+		keys = append(keys, stack)
+	}
+	sort.Strings(keys)
+	return keys
+}
+
+// Write writes the stacks in the folded format, sorted by stack.
+func (stacks FoldedStacks) Write(output io.Writer) error {
+	writer := bufio.NewWriter(output)
+	for _, stack := range stacks.sortedKeys() {
+		fmt.Fprintf(writer, "%s %s\n", stack, strconv.FormatFloat(stacks[stack], 'f', -1, 64))
+	}
+	return writer.Flush()
+}
+
+// Total returns the number of samples in all stacks.
+func (stacks FoldedStacks) Total() float64 {
+	total := 0.0
+	for _, count := range stacks {
+		total += count
+	}
+	return total
+}
+
+// Filter returns the stacks that contain a frame with the given substring, such as the name
+// of a benchmark function.
+func (stacks FoldedStacks) Filter(frame string) FoldedStacks {
+	filtered := FoldedStacks{}
+	for stack, count := range stacks {
+		for _, f := range strings.Split(stack, ";") {
+			if strings.Contains(f, frame) {
+				filtered[stack] = count
+				break
+			}
+		}
+	}
+	return filtered
+}
+
+// WriteDifferentialFoldedStacks writes the stacks of two profiles in the format
+// difffolded.pl produces: each stack followed by its sample counts in the old and the new
+// profile. flamegraph.pl renders this as a differential flame graph. The old counts are
+// scaled to the total of the new profile, so that profiles with different numbers of samples
+// can be compared, like difffolded.pl -n does.
+func WriteDifferentialFoldedStacks(output io.Writer, oldStacks FoldedStacks, newStacks FoldedStacks) error {
+	scale := 1.0
+	if oldTotal := oldStacks.Total(); oldTotal > 0 {
+		scale = newStacks.Total() / oldTotal
+	}
+
+	all := FoldedStacks{}
+	for stack := range oldStacks {
+		all[stack] = 0
+	}
+	for stack := range newStacks {
+		all[stack] = 0
+	}
+
+	writer := bufio.NewWriter(output)
+	for _, stack := range all.sortedKeys() {
+		fmt.Fprintf(writer, "%s %v %v\n", stack, int64(math.Round(oldStacks[stack]*scale)), int64(math.Round(newStacks[stack])))
+	}
+	return writer.Flush()
+}
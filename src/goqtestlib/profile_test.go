@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bytes"
+	"strings"
+	"testing"
+)
+
+const perfScriptOutput = `# ========
+# captured on: Thu Jan  1 00:00:00 2026
+tst_bench_qstr  4711 12345.678901:     250000 cycles:u: 
+	    7f0a1b2c3d4e QString::toUpper_helper(QString const&)+0x1e (/opt/qt/lib/libQt6Core.so.6.5.0)
+	    55d0c0de0001 tst_QString::toUpper()+0x42 (/build/tst_bench_qstring)
+	    55d0c0de0002 main+0x10 (/build/tst_bench_qstring)
+
+tst_bench_qstr  4711 12345.679001:     250000 cycles:u: 
+	    7f0a1b2c3d4e QString::toUpper_helper(QString const&)+0x22 (/opt/qt/lib/libQt6Core.so.6.5.0)
+	    55d0c0de0001 tst_QString::toUpper()+0x42 (/build/tst_bench_qstring)
+	    55d0c0de0002 main+0x10 (/build/tst_bench_qstring)
+
+tst_bench_qstr  4711 12345.679101:     250000 cycles:u: 
+	    7f0a1b2c0000 [unknown] (/usr/lib/libc.so.6)
+	    55d0c0de0003 tst_QString::append()+0x7 (/build/tst_bench_qstring)
+`
+
+func TestFoldPerfScript(t *testing.T) {
+	stacks, err := FoldPerfScript(strings.NewReader(perfScriptOutput))
+	if err != nil {
+		t.Fatalf("Error folding perf script output: %s", err)
+	}
+
+	var folded bytes.Buffer
+	stacks.Write(&folded)
+	expected := "tst_bench_qstr;main;tst_QString::toUpper();QString::toUpper_helper(QString const&) 2\n" +
+		"tst_bench_qstr;tst_QString::append();[libc.so.6] 1\n"
+	if folded.String() != expected {
+		t.Errorf("Unexpected folded stacks:\n%s", folded.String())
+	}
+
+	reread := FoldedStacks{}
+	if err := reread.Read(&folded); err != nil {
+		t.Fatalf("Error reading folded stacks: %s", err)
+	}
+	if len(reread) != 2 || reread.Total() != 3 {
+		t.Errorf("Unexpected stacks after reading them back: %v", reread)
+	}
+
+	if filtered := stacks.Filter("tst_QString::append"); len(filtered) != 1 || filtered.Total() != 1 {
+		t.Errorf("Unexpected filtered stacks: %v", filtered)
+	}
+}
+
+func TestWriteDifferentialFoldedStacks(t *testing.T) {
+	oldStacks := FoldedStacks{"a;b": 10, "a;c": 10}
+	newStacks := FoldedStacks{"a;b": 5, "a;d": 5}
+
+	var output bytes.Buffer
+	WriteDifferentialFoldedStacks(&output, oldStacks, newStacks)
+	// the old profile is scaled to the 10 samples of the new one.
+	expected := "a;b 5 5\na;c 5 0\na;d 0 5\n"
+	if output.String() != expected {
+		t.Errorf("Unexpected differential stacks:\n%s", output.String())
+	}
+}
+
+func TestProfileFileName(t *testing.T) {
+	if fileName := ProfileFileName("corelib/tools/qstring", 3, "folded"); fileName != "corelib/tools/qstring.rep3.folded" {
+		t.Errorf("Unexpected profile file name %s", fileName)
+	}
+	name, repetition, ok := SplitProfileFileName("corelib/tools/qstring.folded", "folded")
+	if !ok || name != "corelib/tools/qstring" || repetition != 1 {
+		t.Errorf("Unexpected split of profile file name: %s %v %v", name, repetition, ok)
+	}
+	if _, _, ok := SplitProfileFileName("corelib/tools/qstring.xml", "folded"); ok {
+		t.Errorf("Results should not be taken for profiles")
+	}
+}
@@ -40,13 +40,17 @@ package goqtestlib
 
 import (
 	"archive/tar"
+	"bytes"
 	"compress/gzip"
 	"encoding/xml"
 	"fmt"
+	"hash/crc32"
 	"io"
 	"io/ioutil"
 	"log"
 	"os"
+	"runtime"
+	"time"
 )
 
 // Environment provides information about the environment used to
@@ -74,7 +78,8 @@ type Duration struct {
 // Incident usually refers to a failing or a passing test function.
 type Incident struct {
 	IncidentHeader
-	DataTag string `xml:",omitempty"`
+	DataTag     string `xml:",omitempty"`
+	Description string `xml:",omitempty"`
 }
 
 // Message represents an arbitrary message produced by QTestLib, usually qDebug() output.
@@ -102,20 +107,22 @@ type TestFunction struct {
 
 // FailingIncidents returns a list of incidents that represent tests failures
 // while the test function was running. For example in table driven tests
-// that is one entry per failed test row.
+// that is one entry per failed test row, as function:tag, the syntax QTestLib
+// accepts on the command line for running a single row.
 func (t *TestFunction) FailingIncidents() []string {
 	var failures []string
+	seen := map[string]bool{}
 	for _, incident := range t.Incidents {
-		if incident.Type == "fail" {
-			name := t.Name
-			/* No support for tags at the moment due to quoting issues on Windows
-			if incident.DataTag != "" {
-				name += ":"
-				name += incident.DataTag
-			}
-			*/
+		if incident.Type != "fail" {
+			continue
+		}
+		name := t.Name
+		if incident.DataTag != "" {
+			name += ":" + incident.DataTag
+		}
+		if !seen[name] {
+			seen[name] = true
 			failures = append(failures, name)
-			break
 		}
 	}
 	return failures
@@ -130,7 +137,8 @@ type ParsedTestResult struct {
 	Duration  Duration       `xml:"Duration"`
 }
 
-// FailingFunctions returns list of test functions that failed during an earlier run.
+// FailingFunctions returns list of test functions and data rows that failed during an earlier
+// run, as function or function:tag.
 func (p *ParsedTestResult) FailingFunctions() []string {
 	var failing []string
 	for _, f := range p.Functions {
@@ -145,38 +153,269 @@ type TestResult struct {
 	PathToResultsXML string // path where the testlib xml output is stored
 }
 
-// Parse attempts to read the XML file the PathToResultsXML field points to.
+// Parse attempts to read the XML file the PathToResultsXML field points to, including all
+// messages. Use ParseWithOptions to skip the parts that are not needed.
 func (r *TestResult) Parse() (*ParsedTestResult, error) {
-	xmlContents, err := ioutil.ReadFile(r.PathToResultsXML)
+	return r.ParseWithOptions(ParseOptions{Incidents: true, Messages: true, BenchmarkResults: true})
+}
+
+// ParseWithOptions reads the XML file the PathToResultsXML field points to, decoding the
+// parts of the test functions selected by the options.
+func (r *TestResult) ParseWithOptions(options ParseOptions) (*ParsedTestResult, error) {
+	file, err := os.Open(r.PathToResultsXML)
 	if err != nil {
 		return nil, fmt.Errorf("Error reading results xml file %s: %s", r.PathToResultsXML, err)
 	}
+	defer file.Close()
+
+	testCase, err := ParseTestResult(file, options)
+	if err != nil {
+		return nil, fmt.Errorf("Error parsing %s: %s", r.PathToResultsXML, err)
+	}
+	return testCase, nil
+}
 
-	testCase := &ParsedTestResult{}
-	if err = xml.Unmarshal(xmlContents, &testCase); err != nil {
-		return nil, fmt.Errorf("Error unmarshalling testlib xml output: %s", err)
+// FailingFunctions returns the test functions and data rows that failed, like
+// ParsedTestResult.FailingFunctions. Only the incidents are decoded and no test function is
+// kept in memory, which makes this much cheaper than parsing the whole results.
+func (r *TestResult) FailingFunctions() ([]string, error) {
+	file, err := os.Open(r.PathToResultsXML)
+	if err != nil {
+		return nil, fmt.Errorf("Error reading results xml file %s: %s", r.PathToResultsXML, err)
 	}
+	defer file.Close()
 
-	return testCase, err
+	var failing []string
+	parser := NewTestResultParser(file, ParseOptions{Incidents: true})
+	for parser.Next() {
+		failing = append(failing, parser.Function().FailingIncidents()...)
+	}
+	if err := parser.Err(); err != nil {
+		return nil, fmt.Errorf("Error parsing %s: %s", r.PathToResultsXML, err)
+	}
+	return failing, nil
+}
+
+// ParseBenchmarkResults reads QTestLib XML output from the reader and returns the test case
+// with its test functions and their benchmark results. All other elements, such as incidents
+// and messages, are skipped without being decoded, so that even large outputs are read
+// quickly and without keeping them in memory.
+func ParseBenchmarkResults(reader io.Reader) (*ParsedTestResult, error) {
+	return ParseTestResult(reader, ParseOptions{BenchmarkResults: true})
+}
+
+func attributeValue(element xml.StartElement, name string) string {
+	for _, attribute := range element.Attr {
+		if attribute.Name.Local == name {
+			return attribute.Value
+		}
+	}
+	return ""
 }
 
 // TestResultCollection is a collection of test results after running tests on a module of source code.
 type TestResultCollection []TestResult
 
+// ArchiveOptions control how TestResultCollection.ArchiveWithOptions compresses the results.
+type ArchiveOptions struct {
+	// CompressionLevel is the gzip compression level.
+	CompressionLevel int
+	// Concurrency is the number of goroutines compressing the archive and reading the result
+	// files ahead of it. With 1 the archive is written as a single gzip member.
+	Concurrency int
+	// ResultsTable adds a ResultsTable with the benchmark results of all files to the archive.
+	// Building it parses every file, which is only worth it for archives of benchmark results.
+	ResultsTable bool
+}
+
+// DefaultArchiveOptions returns the options used by Archive, which use all CPUs and archive
+// only the result files.
+func DefaultArchiveOptions() ArchiveOptions {
+	return ArchiveOptions{CompressionLevel: gzip.DefaultCompression, Concurrency: runtime.GOMAXPROCS(0)}
+}
+
 // Archive produces a .tar.gz archive of the collection and writes it into the given destination writer.
 func (collection *TestResultCollection) Archive(destination io.Writer) (err error) {
-	compressor := gzip.NewWriter(destination)
+	return collection.ArchiveWithOptions(destination, DefaultArchiveOptions())
+}
+
+// prefetchSizeLimit is the size up to which result files are read into memory ahead of
+// being archived. Larger files are copied into the archive from disk.
+const prefetchSizeLimit = 4 << 20
+
+// prefetchedResult is a result file read ahead of archiving it. The contents are nil for
+// large files. If a results table is built, source and testCase hold the file's entry in it,
+// except for large files.
+type prefetchedResult struct {
+	info     os.FileInfo
+	contents []byte
+	source   ResultsFile
+	testCase *ParsedTestResult
+	err      error
+}
+
+func prefetchResult(result TestResult, resultsTable bool) prefetchedResult {
+	info, err := os.Stat(result.PathToResultsXML)
+	if err != nil {
+		return prefetchedResult{err: fmt.Errorf("Error call stat() on %s: %s", result.PathToResultsXML, err)}
+	}
+	if info.Size() > prefetchSizeLimit {
+		return prefetchedResult{info: info}
+	}
+	contents, err := ioutil.ReadFile(result.PathToResultsXML)
+	if err != nil {
+		return prefetchedResult{err: fmt.Errorf("Error opening results file %s: %s", result.PathToResultsXML, err)}
+	}
+	prefetched := prefetchedResult{info: info, contents: contents}
+	if resultsTable {
+		prefetched.source = NewResultsFile(result.TestCaseName+".xml", contents)
+		prefetched.testCase = parseResultsTableEntry(bytes.NewReader(contents))
+	}
+	return prefetched
+}
+
+// parseResultsTableEntry returns the benchmark results of a result file for the results
+// table. Files that are not valid QTestLib XML, such as the output of crashed tests, are
+// recorded without results.
+func parseResultsTableEntry(reader io.Reader) *ParsedTestResult {
+	testCase, err := ParseBenchmarkResults(reader)
+	if err != nil {
+		return nil
+	}
+	return testCase
+}
+
+// resultPrefetcher reads the result files of a collection on several goroutines, a limited
+// number of files ahead of the consumer, so that archiving doesn't wait for the file system.
+type resultPrefetcher struct {
+	results []chan prefetchedResult
+	ahead   chan struct{}
+	done    chan struct{}
+}
+
+func (collection TestResultCollection) prefetch(concurrency int, resultsTable bool) *resultPrefetcher {
+	prefetcher := &resultPrefetcher{
+		results: make([]chan prefetchedResult, len(collection)),
+		ahead:   make(chan struct{}, 2*concurrency),
+		done:    make(chan struct{}),
+	}
+	for i := range prefetcher.results {
+		prefetcher.results[i] = make(chan prefetchedResult, 1)
+	}
+
+	jobs := make(chan int)
+	for worker := 0; worker < concurrency; worker++ {
+		go func() {
+			for i := range jobs {
+				prefetcher.results[i] <- prefetchResult(collection[i], resultsTable)
+			}
+		}()
+	}
+
+	go func() {
+		defer close(jobs)
+		for i := range collection {
+			select {
+			case prefetcher.ahead <- struct{}{}:
+			case <-prefetcher.done:
+				return
+			}
+			select {
+			case jobs <- i:
+			case <-prefetcher.done:
+				return
+			}
+		}
+	}()
+	return prefetcher
+}
+
+// next returns the prefetched file of the i-th result. The results need to be taken in order.
+func (prefetcher *resultPrefetcher) next(i int) prefetchedResult {
+	result := <-prefetcher.results[i]
+	<-prefetcher.ahead
+	return result
+}
+
+// stop ends the prefetching.
+func (prefetcher *resultPrefetcher) stop() {
+	close(prefetcher.done)
+}
+
+func copyFile(destination io.Writer, path string) error {
+	file, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer file.Close()
+	_, err = io.Copy(destination, file)
+	return err
+}
+
+// copyAndParseFile copies a large result file like copyFile, and parses it for the results
+// table while it is being copied, so that the file is only read once.
+func copyAndParseFile(destination io.Writer, path string, name string) (ResultsFile, *ParsedTestResult, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return ResultsFile{}, nil, err
+	}
+	defer file.Close()
+
+	parserInput, copied := io.Pipe()
+	parsed := make(chan *ParsedTestResult)
+	go func() {
+		testCase := parseResultsTableEntry(parserInput)
+		// the copy goes on after a parse error, or after the end of the test case.
+		io.Copy(ioutil.Discard, parserInput)
+		parsed <- testCase
+	}()
+
+	checksum := crc32.NewIEEE()
+	size, err := io.Copy(io.MultiWriter(destination, checksum, copied), file)
+	copied.CloseWithError(err)
+	testCase := <-parsed
+	if err != nil {
+		return ResultsFile{}, nil, err
+	}
+	return ResultsFile{Name: name, Size: uint64(size), CRC32: checksum.Sum32()}, testCase, nil
+}
+
+// ArchiveWithOptions produces a .tar.gz archive of the collection like Archive. The result
+// files are read ahead and compressed in parallel according to the options.
+func (collection *TestResultCollection) ArchiveWithOptions(destination io.Writer, options ArchiveOptions) (err error) {
+	if options.Concurrency < 1 {
+		options.Concurrency = 1
+	}
+
+	var compressor io.WriteCloser
+	if options.Concurrency == 1 {
+		compressor, err = gzip.NewWriterLevel(destination, options.CompressionLevel)
+	} else {
+		compressor, err = NewParallelGzipWriter(destination, options.CompressionLevel, options.Concurrency, DefaultGzipBlockSize)
+	}
+	if err != nil {
+		return err
+	}
 
 	archiver := tar.NewWriter(compressor)
 
 	log.Printf("Collecting %v test results ...\n", len(*collection))
 
-	for _, result := range *collection {
-		stat, err := os.Stat(result.PathToResultsXML)
-		if err != nil {
-			return fmt.Errorf("Error call stat() on %s: %s", result.PathToResultsXML, err)
+	var table *ResultsTable
+	if options.ResultsTable {
+		table = &ResultsTable{}
+	}
+
+	prefetcher := collection.prefetch(options.Concurrency, table != nil)
+	defer prefetcher.stop()
+
+	for i, result := range *collection {
+		file := prefetcher.next(i)
+		if file.err != nil {
+			return file.err
 		}
-		header, err := tar.FileInfoHeader(stat, "")
+
+		header, err := tar.FileInfoHeader(file.info, "")
 		if err != nil {
 			return fmt.Errorf("Error creating tar file header for %s: %s", result.PathToResultsXML, err)
 		}
@@ -186,17 +425,34 @@ func (collection *TestResultCollection) Archive(destination io.Writer) (err erro
 			return fmt.Errorf("Error writing tar file header for %s: %s", result.PathToResultsXML, err)
 		}
 
-		file, err := os.Open(result.PathToResultsXML)
+		if file.contents != nil {
+			_, err = archiver.Write(file.contents)
+		} else if table != nil {
+			file.source, file.testCase, err = copyAndParseFile(archiver, result.PathToResultsXML, header.Name)
+		} else {
+			err = copyFile(archiver, result.PathToResultsXML)
+		}
 		if err != nil {
-			return fmt.Errorf("Error opening results file %s: %s", result.PathToResultsXML, err)
+			return fmt.Errorf("Error writing results file %s into archive: %s", result.PathToResultsXML, err)
 		}
 
-		if _, err := io.Copy(archiver, file); err != nil {
-			file.Close()
-			return fmt.Errorf("Error writing results file %s into archive: %s", result.PathToResultsXML, err)
+		if table != nil {
+			table.AddResultsFile(file.source, file.testCase)
 		}
+	}
 
-		file.Close()
+	if table != nil {
+		var contents bytes.Buffer
+		if err := table.Write(&contents); err != nil {
+			return err
+		}
+		header := &tar.Header{Name: ResultsTableFileName, Mode: 0644, Size: int64(contents.Len()), ModTime: time.Now()}
+		if err := archiver.WriteHeader(header); err != nil {
+			return fmt.Errorf("Error writing tar file header for %s: %s", ResultsTableFileName, err)
+		}
+		if _, err := archiver.Write(contents.Bytes()); err != nil {
+			return fmt.Errorf("Error writing %s into archive: %s", ResultsTableFileName, err)
+		}
 	}
 
 	if err := archiver.Close(); err != nil {
@@ -39,12 +39,21 @@
 package goqtestlib
 
 import (
+	"archive/tar"
+	"bytes"
+	"compress/gzip"
 	"encoding/xml"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
 	"testing"
 )
 
-func TestXMLSchema(t *testing.T) {
-	rawXML := `<?xml version="1.0" encoding="UTF-8"?>
+const rawXML = `<?xml version="1.0" encoding="UTF-8"?>
 <TestCase name="tst_QIODevice">
 <Environment>
     <QtVersion>5.6.0</QtVersion>
@@ -74,6 +83,7 @@ func TestXMLSchema(t *testing.T) {
 <Duration msecs="760.801970"/>
 </TestCase>`
 
+func TestXMLSchema(t *testing.T) {
 	actual := &ParsedTestResult{}
 	err := xml.Unmarshal([]byte(rawXML), &actual)
 	if err != nil {
@@ -189,3 +199,189 @@ func TestXMLSchema(t *testing.T) {
 		t.Errorf("Incorrectly parsed benchmark iteration count %v", result.Iterations)
 	}
 }
+
+func TestParseBenchmarkResults(t *testing.T) {
+	actual, err := ParseBenchmarkResults(strings.NewReader(rawXML))
+	if err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+
+	if actual.Name != "tst_QIODevice" {
+		t.Errorf("Invalid name attribute decoding. Got %s", actual.Name)
+	}
+
+	if actual.Env.QtVersion != "5.6.0" {
+		t.Errorf("Error decoding Qt version from environment. Got %s", actual.Env.QtVersion)
+	}
+
+	if len(actual.Functions) != 3 {
+		t.Fatalf("Incorrect number of parsed test functions. Got %v", len(actual.Functions))
+	}
+
+	for _, function := range actual.Functions {
+		if len(function.Incidents) != 0 || len(function.Messages) != 0 {
+			t.Errorf("Incidents and messages should be skipped for %s", function.Name)
+		}
+	}
+
+	function := actual.Functions[2]
+	if function.Name != "readLine2" {
+		t.Errorf("Incorrectly parsed test function name. Got %s", function.Name)
+	}
+
+	if len(function.BenchmarkResults) != 1 {
+		t.Fatalf("Incorrectly parsed number of benchmark results. Expected 1 got %v", len(function.BenchmarkResults))
+	}
+
+	result := function.BenchmarkResults[0]
+	if result.Metric != "InstructionReads" || result.Value != 19838 || result.Iterations != 1 {
+		t.Errorf("Incorrectly parsed benchmark result %v", result)
+	}
+
+	if _, err := ParseBenchmarkResults(strings.NewReader(rawXML[:len(rawXML)/2])); err == nil {
+		t.Errorf("Truncated XML should produce an error")
+	}
+}
+
+func TestTestResultParser(t *testing.T) {
+	parser := NewTestResultParser(strings.NewReader(rawXML), DefaultParseOptions())
+	var names []string
+	for parser.Next() {
+		function := parser.Function()
+		names = append(names, function.Name)
+		if len(function.Messages) != 0 {
+			t.Errorf("Messages of %s should be skipped by default", function.Name)
+		}
+		if function.Name == "readLine2" {
+			if len(function.Incidents) != 2 || function.Incidents[1].DataTag != "1024 - 3" {
+				t.Errorf("Incorrectly parsed incidents %v", function.Incidents)
+			}
+			if len(function.BenchmarkResults) != 1 || function.BenchmarkResults[0].Value != 19838 {
+				t.Errorf("Incorrectly parsed benchmark results %v", function.BenchmarkResults)
+			}
+		}
+	}
+	if err := parser.Err(); err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+	if strings.Join(names, ",") != "initTestCase,getSetCheck,readLine2" {
+		t.Errorf("Unexpected test functions %v", names)
+	}
+
+	testCase := parser.TestCase()
+	if testCase.Name != "tst_QIODevice" || testCase.Env.QtVersion != "5.6.0" || testCase.Duration.Msecs != 760.801970 {
+		t.Errorf("Incorrectly parsed test case %v", testCase)
+	}
+
+	parser = NewTestResultParser(strings.NewReader(rawXML[:len(rawXML)/2]), DefaultParseOptions())
+	for parser.Next() {
+	}
+	if parser.Err() == nil {
+		t.Errorf("Truncated XML should produce an error")
+	}
+}
+
+func TestParseTestResultMatchesUnmarshal(t *testing.T) {
+	expected := &ParsedTestResult{}
+	if err := xml.Unmarshal([]byte(rawXML), expected); err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+
+	actual, err := ParseTestResult(strings.NewReader(rawXML), ParseOptions{Incidents: true, Messages: true, BenchmarkResults: true})
+	if err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+
+	if !reflect.DeepEqual(expected, actual) {
+		t.Errorf("Streaming parser produced %v, expected %v", actual, expected)
+	}
+}
+
+func TestArchive(t *testing.T) {
+	dir, err := ioutil.TempDir("", "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	var collection TestResultCollection
+	expected := map[string]string{}
+	for i := 0; i < 20; i++ {
+		path := filepath.Join(dir, fmt.Sprintf("result%v", i))
+		contents := strings.Repeat(rawXML, i)
+		if err := ioutil.WriteFile(path, []byte(contents), 0644); err != nil {
+			t.Fatal(err)
+		}
+		name := fmt.Sprintf("tests/auto/test%v", i)
+		collection = append(collection, TestResult{TestCaseName: name, PathToResultsXML: path})
+		expected[name+".xml"] = contents
+	}
+	// a file too large to be read ahead is parsed for the results table while it is copied.
+	largeRepetitions := prefetchSizeLimit/len(rawXML) + 1
+	largePath := filepath.Join(dir, "large")
+	largeContents := strings.Repeat(rawXML, largeRepetitions)
+	if err := ioutil.WriteFile(largePath, []byte(largeContents), 0644); err != nil {
+		t.Fatal(err)
+	}
+	collection = append(collection, TestResult{TestCaseName: "tests/auto/large", PathToResultsXML: largePath})
+	expected["tests/auto/large.xml"] = largeContents
+
+	var sources []ResultsFile
+	for name, contents := range expected {
+		sources = append(sources, NewResultsFile(name, []byte(contents)))
+	}
+
+	for _, options := range []ArchiveOptions{
+		{CompressionLevel: gzip.BestSpeed, Concurrency: 3},
+		{CompressionLevel: gzip.BestSpeed, Concurrency: 1, ResultsTable: true},
+		{CompressionLevel: gzip.BestSpeed, Concurrency: 3, ResultsTable: true},
+	} {
+		var archive bytes.Buffer
+		if err := collection.ArchiveWithOptions(&archive, options); err != nil {
+			t.Fatalf("Error archiving with %v: %s", options, err)
+		}
+
+		decompressor, err := gzip.NewReader(&archive)
+		if err != nil {
+			t.Fatalf("Error reading archive: %s", err)
+		}
+		reader := tar.NewReader(decompressor)
+		found := 0
+		foundTable := false
+		for {
+			header, err := reader.Next()
+			if err == io.EOF {
+				break
+			}
+			if err != nil {
+				t.Fatalf("Error reading archive: %s", err)
+			}
+			if header.Name == ResultsTableFileName {
+				foundTable = true
+				table, err := ReadResultsTable(reader)
+				if err != nil {
+					t.Fatalf("Error reading results table from archive: %s", err)
+				}
+				// file i repeats the test case with one benchmark result i times.
+				if expectedRows := 20*19/2 + largeRepetitions; table.Len() != expectedRows {
+					t.Errorf("Expected %v rows in the results table, got %v", expectedRows, table.Len())
+				}
+				if !table.Covers(sources) {
+					t.Errorf("The results table should cover all files, got %v", table.Sources)
+				}
+				continue
+			}
+			contents, _ := ioutil.ReadAll(reader)
+			if string(contents) != expected[header.Name] {
+				t.Errorf("Unexpected contents of %s in archive", header.Name)
+			}
+			found++
+		}
+		if found != len(collection) {
+			t.Errorf("Expected %v files in the archive, found %v", len(collection), found)
+		}
+		if foundTable != options.ResultsTable {
+			t.Errorf("Unexpected results table in the archive with %v", options)
+		}
+	}
+}
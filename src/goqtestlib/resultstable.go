@@ -0,0 +1,368 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"math"
+)
+
+// ResultsTableFileName is the name of the results table in results archives.
+const ResultsTableFileName = "results.qtrc"
+
+// resultsTableMagic starts every results table file, followed by the format version.
+// Version 2 added the list of source files.
+const (
+	resultsTableMagic   = "QTRC"
+	resultsTableVersion = 2
+)
+
+// maxResultsTableString limits the length of the strings in a results table, so that a
+// corrupt length can't make readers allocate huge amounts of memory.
+const maxResultsTableString = 1 << 20
+
+// ResultsFile identifies the contents of a results file covered by a results table, so that
+// readers can tell whether the table is up to date with the files next to it.
+type ResultsFile struct {
+	Name  string
+	Size  uint64
+	CRC32 uint32
+}
+
+// NewResultsFile describes the results file of the given name and contents.
+func NewResultsFile(name string, contents []byte) ResultsFile {
+	return ResultsFile{Name: name, Size: uint64(len(contents)), CRC32: crc32.ChecksumIEEE(contents)}
+}
+
+// ResultsTable holds the benchmark results of a set of test result files in columns, with one
+// row per benchmark result. It is stored next to the XML files in results archives, so that
+// tools comparing results don't need to parse the XML again. The file is a string table
+// followed by the columns, with strings referred to by index and integers stored as varints,
+// and the list of source files.
+type ResultsTable struct {
+	// Sources lists all results files the table was built from, including those without
+	// benchmark results. It is empty for tables written before version 2.
+	Sources []ResultsFile
+
+	// File is the name of the XML file the result belongs to, such as its name in the archive.
+	File       []string
+	TestCase   []string
+	Function   []string
+	Tag        []string
+	Metric     []string
+	Value      []float64
+	Iterations []int
+}
+
+// Len returns the number of rows.
+func (table *ResultsTable) Len() int {
+	return len(table.Value)
+}
+
+// AddTestCase adds a row for each benchmark result of the test case, read from the given file.
+func (table *ResultsTable) AddTestCase(file string, testCase *ParsedTestResult) {
+	for _, function := range testCase.Functions {
+		for _, result := range function.BenchmarkResults {
+			table.File = append(table.File, file)
+			table.TestCase = append(table.TestCase, testCase.Name)
+			table.Function = append(table.Function, function.Name)
+			table.Tag = append(table.Tag, result.Tag)
+			table.Metric = append(table.Metric, result.Metric)
+			table.Value = append(table.Value, result.Value)
+			table.Iterations = append(table.Iterations, result.Iterations)
+		}
+	}
+}
+
+// AddResultsFile records a results file the table is built from and adds the benchmark
+// results of its test case, if it could be parsed.
+func (table *ResultsTable) AddResultsFile(file ResultsFile, testCase *ParsedTestResult) {
+	table.Sources = append(table.Sources, file)
+	if testCase != nil {
+		table.AddTestCase(file.Name, testCase)
+	}
+}
+
+// Covers returns true if the table was built from exactly the given results files, with the
+// same contents. Tables that don't list their source files only cover an empty set of files.
+func (table *ResultsTable) Covers(files []ResultsFile) bool {
+	if len(table.Sources) != len(files) {
+		return false
+	}
+	sources := map[string]ResultsFile{}
+	for _, source := range table.Sources {
+		sources[source.Name] = source
+	}
+	for _, file := range files {
+		if source, ok := sources[file.Name]; !ok || source != file {
+			return false
+		}
+	}
+	return true
+}
+
+// Files returns the names of the files with results in the table, in the order they were added.
+func (table *ResultsTable) Files() []string {
+	var files []string
+	seen := map[string]bool{}
+	for _, file := range table.File {
+		if !seen[file] {
+			seen[file] = true
+			files = append(files, file)
+		}
+	}
+	return files
+}
+
+// ForEachTestCase calls the callback with the benchmark results of each file in the table, in
+// the form ParseBenchmarkResults returns them. Test functions without benchmark results are
+// not part of the table.
+func (table *ResultsTable) ForEachTestCase(callback func(file string, testCase *ParsedTestResult) error) error {
+	for begin := 0; begin < table.Len(); {
+		end := begin
+		for end < table.Len() && table.File[end] == table.File[begin] {
+			end++
+		}
+
+		testCase := &ParsedTestResult{Name: table.TestCase[begin]}
+		for row := begin; row < end; row++ {
+			if len(testCase.Functions) == 0 || testCase.Functions[len(testCase.Functions)-1].Name != table.Function[row] {
+				testCase.Functions = append(testCase.Functions, TestFunction{Name: table.Function[row]})
+			}
+			function := &testCase.Functions[len(testCase.Functions)-1]
+			function.BenchmarkResults = append(function.BenchmarkResults, BenchmarkResult{
+				Metric:     table.Metric[row],
+				Tag:        table.Tag[row],
+				Value:      table.Value[row],
+				Iterations: table.Iterations[row],
+			})
+		}
+
+		if err := callback(table.File[begin], testCase); err != nil {
+			return err
+		}
+		begin = end
+	}
+	return nil
+}
+
+// Write stores the table in its binary format.
+func (table *ResultsTable) Write(writer io.Writer) error {
+	output := bufio.NewWriter(writer)
+	var scratch [binary.MaxVarintLen64]byte
+	writeUvarint := func(value uint64) {
+		output.Write(scratch[:binary.PutUvarint(scratch[:], value)])
+	}
+
+	output.WriteString(resultsTableMagic)
+	writeUvarint(resultsTableVersion)
+
+	index := map[string]uint64{}
+	var strings []string
+	stringColumns := [][]string{table.File, table.TestCase, table.Function, table.Tag, table.Metric}
+	for _, column := range stringColumns {
+		for _, value := range column {
+			if _, ok := index[value]; !ok {
+				index[value] = uint64(len(strings))
+				strings = append(strings, value)
+			}
+		}
+	}
+	writeUvarint(uint64(len(strings)))
+	for _, value := range strings {
+		writeUvarint(uint64(len(value)))
+		output.WriteString(value)
+	}
+
+	writeUvarint(uint64(table.Len()))
+	for _, column := range stringColumns {
+		for _, value := range column {
+			writeUvarint(index[value])
+		}
+	}
+	for _, value := range table.Value {
+		binary.LittleEndian.PutUint64(scratch[:8], math.Float64bits(value))
+		output.Write(scratch[:8])
+	}
+	for _, iterations := range table.Iterations {
+		writeUvarint(uint64(iterations))
+	}
+
+	writeUvarint(uint64(len(table.Sources)))
+	for _, source := range table.Sources {
+		writeUvarint(uint64(len(source.Name)))
+		output.WriteString(source.Name)
+		writeUvarint(source.Size)
+		binary.LittleEndian.PutUint32(scratch[:4], source.CRC32)
+		output.Write(scratch[:4])
+	}
+	return output.Flush()
+}
+
+// ReadResultsTable reads a table written by ResultsTable.Write. Corrupt or truncated tables
+// make it return an error; the columns only grow with the data actually read, whatever the
+// counts in the file claim.
+func ReadResultsTable(reader io.Reader) (*ResultsTable, error) {
+	table, err := readResultsTable(bufio.NewReader(reader))
+	if err == io.EOF {
+		err = io.ErrUnexpectedEOF
+	}
+	if err != nil {
+		return nil, fmt.Errorf("Error reading results table: %s", err)
+	}
+	return table, nil
+}
+
+// readResultsTableString reads a string stored as its length followed by its bytes.
+func readResultsTableString(input *bufio.Reader) (string, error) {
+	length, err := binary.ReadUvarint(input)
+	if err != nil {
+		return "", err
+	}
+	if length > maxResultsTableString {
+		return "", fmt.Errorf("Invalid string length %v", length)
+	}
+	var value bytes.Buffer
+	if _, err := io.CopyN(&value, input, int64(length)); err != nil {
+		return "", err
+	}
+	return value.String(), nil
+}
+
+func readResultsTable(input *bufio.Reader) (*ResultsTable, error) {
+	magic := make([]byte, len(resultsTableMagic))
+	if _, err := io.ReadFull(input, magic); err != nil {
+		return nil, err
+	}
+	if string(magic) != resultsTableMagic {
+		return nil, errors.New("Not a results table")
+	}
+	version, err := binary.ReadUvarint(input)
+	if err != nil {
+		return nil, err
+	}
+	if version < 1 || version > resultsTableVersion {
+		return nil, fmt.Errorf("Unsupported version %v", version)
+	}
+
+	count, err := binary.ReadUvarint(input)
+	if err != nil {
+		return nil, err
+	}
+	var strings []string
+	for i := uint64(0); i < count; i++ {
+		value, err := readResultsTableString(input)
+		if err != nil {
+			return nil, err
+		}
+		strings = append(strings, value)
+	}
+
+	rows, err := binary.ReadUvarint(input)
+	if err != nil {
+		return nil, err
+	}
+	readStrings := func() ([]string, error) {
+		var column []string
+		for row := uint64(0); row < rows; row++ {
+			i, err := binary.ReadUvarint(input)
+			if err != nil {
+				return nil, err
+			}
+			if i >= uint64(len(strings)) {
+				return nil, fmt.Errorf("Invalid string index %v", i)
+			}
+			column = append(column, strings[i])
+		}
+		return column, nil
+	}
+
+	table := &ResultsTable{}
+	for _, column := range []*[]string{&table.File, &table.TestCase, &table.Function, &table.Tag, &table.Metric} {
+		if *column, err = readStrings(); err != nil {
+			return nil, err
+		}
+	}
+
+	var bits [8]byte
+	for row := uint64(0); row < rows; row++ {
+		if _, err := io.ReadFull(input, bits[:]); err != nil {
+			return nil, err
+		}
+		table.Value = append(table.Value, math.Float64frombits(binary.LittleEndian.Uint64(bits[:])))
+	}
+
+	for row := uint64(0); row < rows; row++ {
+		iterations, err := binary.ReadUvarint(input)
+		if err != nil {
+			return nil, err
+		}
+		table.Iterations = append(table.Iterations, int(iterations))
+	}
+
+	if version < 2 {
+		return table, nil
+	}
+	sources, err := binary.ReadUvarint(input)
+	if err != nil {
+		return nil, err
+	}
+	for i := uint64(0); i < sources; i++ {
+		var source ResultsFile
+		if source.Name, err = readResultsTableString(input); err != nil {
+			return nil, err
+		}
+		if source.Size, err = binary.ReadUvarint(input); err != nil {
+			return nil, err
+		}
+		var crc [4]byte
+		if _, err := io.ReadFull(input, crc[:]); err != nil {
+			return nil, err
+		}
+		source.CRC32 = binary.LittleEndian.Uint32(crc[:])
+		table.Sources = append(table.Sources, source)
+	}
+	return table, nil
+}
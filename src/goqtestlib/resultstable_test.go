@@ -0,0 +1,173 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"bytes"
+	"hash/crc32"
+	"math/rand"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+func TestResultsTable(t *testing.T) {
+	testCase, err := ParseBenchmarkResults(strings.NewReader(rawXML))
+	if err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+	second := &ParsedTestResult{Name: "tst_Other", Functions: []TestFunction{
+		{Name: "first", BenchmarkResults: []BenchmarkResult{
+			{Metric: "WalltimeMilliseconds", Tag: "a", Value: 0.25, Iterations: 16},
+			{Metric: "WalltimeMilliseconds", Tag: "b", Value: 1e9, Iterations: 1},
+		}},
+		{Name: "second", BenchmarkResults: []BenchmarkResult{{Metric: "CPUCycles", Value: 12345}}},
+	}}
+
+	table := &ResultsTable{}
+	table.AddResultsFile(NewResultsFile("io/qiodevice.xml", []byte(rawXML)), testCase)
+	table.AddResultsFile(ResultsFile{Name: "other.rep2.xml", Size: 1234, CRC32: 0xdeadbeef}, second)
+	table.AddResultsFile(NewResultsFile("crashed.xml", []byte("<TestCase")), nil)
+	if table.Len() != 4 {
+		t.Fatalf("Expected 4 rows, got %v", table.Len())
+	}
+
+	var buffer bytes.Buffer
+	if err := table.Write(&buffer); err != nil {
+		t.Fatalf("Error writing table: %s", err)
+	}
+	read, err := ReadResultsTable(bytes.NewReader(buffer.Bytes()))
+	if err != nil {
+		t.Fatalf("Error reading table: %s", err)
+	}
+	if !reflect.DeepEqual(table, read) {
+		t.Errorf("Table changed when reading it back: %v vs %v", read, table)
+	}
+
+	if files := read.Files(); strings.Join(files, ",") != "io/qiodevice.xml,other.rep2.xml" {
+		t.Errorf("Unexpected files %v", files)
+	}
+
+	archived := []ResultsFile{
+		{Name: "crashed.xml", Size: 9, CRC32: crc32.ChecksumIEEE([]byte("<TestCase"))},
+		{Name: "other.rep2.xml", Size: 1234, CRC32: 0xdeadbeef},
+		NewResultsFile("io/qiodevice.xml", []byte(rawXML)),
+	}
+	if !read.Covers(archived) {
+		t.Errorf("Table should cover the files it was built from, in any order")
+	}
+	if read.Covers(archived[1:]) || read.Covers(append(archived, ResultsFile{Name: "new.xml"})) {
+		t.Errorf("Table should not cover missing or added files")
+	}
+	archived[1].CRC32++
+	if read.Covers(archived) {
+		t.Errorf("Table should not cover changed files")
+	}
+
+	var testCases []*ParsedTestResult
+	read.ForEachTestCase(func(file string, testCase *ParsedTestResult) error {
+		testCases = append(testCases, testCase)
+		return nil
+	})
+	if len(testCases) != 2 || !reflect.DeepEqual(testCases[1], second) {
+		t.Errorf("Unexpected test cases from table %v", testCases)
+	}
+	if len(testCases[0].Functions) != 1 || testCases[0].Functions[0].Name != "readLine2" || testCases[0].Name != "tst_QIODevice" {
+		t.Errorf("Only functions with benchmark results should be in the table, got %v", testCases[0])
+	}
+
+	if _, err := ReadResultsTable(bytes.NewReader(buffer.Bytes()[:buffer.Len()-3])); err == nil {
+		t.Errorf("Truncated table should produce an error")
+	}
+	if _, err := ReadResultsTable(strings.NewReader(rawXML)); err == nil {
+		t.Errorf("XML should not be accepted as results table")
+	}
+}
+
+func TestCorruptResultsTable(t *testing.T) {
+	testCase, err := ParseBenchmarkResults(strings.NewReader(rawXML))
+	if err != nil {
+		t.Fatalf("Error decoding XML: %s", err)
+	}
+	table := &ResultsTable{}
+	table.AddResultsFile(NewResultsFile("io/qiodevice.xml", []byte(rawXML)), testCase)
+	var buffer bytes.Buffer
+	if err := table.Write(&buffer); err != nil {
+		t.Fatalf("Error writing table: %s", err)
+	}
+	valid := buffer.Bytes()
+
+	read := func(contents []byte) (table *ResultsTable, err error) {
+		defer func() {
+			if r := recover(); r != nil {
+				t.Fatalf("Reading corrupt table %q panicked: %v", contents, r)
+			}
+		}()
+		return ReadResultsTable(bytes.NewReader(contents))
+	}
+
+	// huge string lengths, string counts and row counts.
+	for _, contents := range []string{
+		"QTRC\x02\x01\xff\xff\xff\xff\xff\xff\xff\xff\x7f",
+		"QTRC\x02\xff\xff\xff\xff\xff\xff\xff\xff\x7f",
+		"QTRC\x02\x00\xff\xff\xff\xff\xff\xff\xff\xff\x7f",
+		"QTRC\x02\x00\x00\xff\xff\xff\xff\xff\xff\xff\xff\x7f",
+		"QTRC\x02\x00\x00\x01\xff\xff\xff\xff\xff\xff\xff\xff\x7f",
+	} {
+		if _, err := read([]byte(contents)); err == nil {
+			t.Errorf("Corrupt table %q should produce an error", contents)
+		}
+	}
+
+	for length := 0; length < len(valid); length++ {
+		if _, err := read(valid[:length]); err == nil {
+			t.Errorf("Table truncated to %v bytes should produce an error", length)
+		}
+	}
+
+	random := rand.New(rand.NewSource(1))
+	corrupt := make([]byte, len(valid))
+	for i := 0; i < 10000; i++ {
+		copy(corrupt, valid)
+		for changes := 1 + random.Intn(4); changes > 0; changes-- {
+			corrupt[random.Intn(len(corrupt))] = []byte{0x00, 0x7f, 0x80, 0xff, byte(random.Intn(256))}[random.Intn(5)]
+		}
+		read(corrupt)
+	}
+}
@@ -39,12 +39,18 @@
 package goqtestlib
 
 import (
+	"bytes"
+	"encoding/xml"
 	"errors"
 	"fmt"
+	"io"
 	"io/ioutil"
 	"os"
 	"os/exec"
 	"path/filepath"
+	"regexp"
+	"strings"
+	"sync"
 )
 
 const (
@@ -56,14 +62,35 @@ const (
 // the agent this usually means running "make check".
 type RunFunction func(extraArgs []string) error
 
+// TestRunOptions control how GenerateTestResultWithOptions deals with failing test functions.
+type TestRunOptions struct {
+	// RepetitionsOnFailure is the number of times failing test functions are run again. The
+	// failure is ignored if none of the repetitions fails.
+	RepetitionsOnFailure int
+	// ParallelRetries is the number of processes that repeat failing test functions at the
+	// same time, each running one function or data row. With 0 or 1 all failing functions are repeated
+	// together in one process at a time. Only tests that can run concurrently with themselves
+	// should be retried in parallel, and the runner function needs to support concurrent calls.
+	ParallelRetries int
+}
+
 // GenerateTestResult sets up the environment for QTestLib style testing and calls the runner function for
 // to produce the test results. The repetitionsOnFailure allows for a failing test function to fail once
 // and have that failure to be ignored under the condition that consequent repeated running of the same
-// test function does not produce any failures.
+// test function does not produce any failures. Of data driven test functions only the failing rows are
+// repeated, if their data tags can be passed on the command line safely.
 func GenerateTestResult(name string, resultsDirectory string, repetitionsOnFailure int, runner RunFunction) (*TestResult, error) {
+	return GenerateTestResultWithOptions(name, resultsDirectory, TestRunOptions{RepetitionsOnFailure: repetitionsOnFailure}, runner)
+}
+
+// GenerateTestResultWithOptions is like GenerateTestResult, with more control over the
+// repetitions of failing test functions. The outcome of each repetition is added to the
+// results as a message of the repeated test function. If a repetition fails, the results
+// are returned along with the error.
+func GenerateTestResultWithOptions(name string, resultsDirectory string, options TestRunOptions, runner RunFunction) (*TestResult, error) {
 	resultsDir := filepath.Join(resultsDirectory, filepath.Dir(name))
 	os.MkdirAll(resultsDir, 0755)
-	resultsFile, err := ioutil.TempFile(resultsDirectory, name)
+	resultsFile, err := ioutil.TempFile(resultsDir, filepath.Base(name))
 	if err != nil {
 		return nil, fmt.Errorf("Error creating temporary file to collected test output: %s", err)
 	}
@@ -90,26 +117,282 @@ func GenerateTestResult(name string, resultsDirectory string, repetitionsOnFailu
 	}
 
 	if err != nil {
-		parsedResult, err := testResult.Parse()
+		failingFunctions, err := testResult.FailingFunctions()
 		if err != nil {
 			return nil, err
 		}
 
-		failingFunctions := parsedResult.FailingFunctions()
 		if len(failingFunctions) > 0 {
-			if repetitionsOnFailure == 0 {
+			if options.RepetitionsOnFailure == 0 {
 				return nil, errors.New("Tests failed")
 			}
 
-			for _, testFunction := range failingFunctions {
-				for i := 0; i < repetitionsOnFailure; i++ {
-					if err = runner([]string{testFunction}); err != nil {
-						return nil, err
-					}
-				}
+			retries, err := testResult.retry(retrySelectors(failingFunctions), options, runner)
+			if err != nil {
+				return nil, err
+			}
+			if err := testResult.recordRetries(retries); err != nil {
+				return nil, err
+			}
+			if failed := failedRetries(retries); len(failed) > 0 {
+				return testResult, fmt.Errorf("Tests failed again when repeated: %s", strings.Join(failed, ", "))
 			}
 		}
 	}
 
 	return testResult, nil
 }
+
+// retryOutcome is the outcome of one repetition of a failing test function or data row. The
+// function holds the selector passed to the test, function or function:tag.
+type retryOutcome struct {
+	function   string
+	repetition int
+	passed     bool
+}
+
+// safeDataTag matches the data tags that can be passed to tests on the command line as they
+// are. QTestLib has no other way of selecting data rows, and the command line may go through
+// make and the Windows command interpreter, which lack a common way of quoting.
+var safeDataTag = regexp.MustCompile(`^[A-Za-z0-9_.-]+$`)
+
+// retrySelectors returns the selectors for repeating the failing functions and data rows, as
+// returned by FailingFunctions. Functions with a data tag that cannot be passed safely are
+// repeated with all their rows.
+func retrySelectors(failing []string) []string {
+	unsafe := map[string]bool{}
+	for _, selector := range failing {
+		if function, tag := splitSelector(selector); tag != "" && !safeDataTag.MatchString(tag) {
+			unsafe[function] = true
+		}
+	}
+
+	var selectors []string
+	seen := map[string]bool{}
+	for _, selector := range failing {
+		if function, _ := splitSelector(selector); unsafe[function] {
+			selector = function
+		}
+		if !seen[selector] {
+			seen[selector] = true
+			selectors = append(selectors, selector)
+		}
+	}
+	return selectors
+}
+
+// splitSelector splits a function:tag selector. Function names cannot contain colons, while
+// tags can.
+func splitSelector(selector string) (function string, tag string) {
+	parts := strings.SplitN(selector, ":", 2)
+	if len(parts) == 2 {
+		return parts[0], parts[1]
+	}
+	return parts[0], ""
+}
+
+// retryPassed returns true if the results of a repetition show that the function or data row
+// selected by the selector passed. The results of a function passed if none of its rows failed,
+// the results of a row if it ran and didn't fail.
+func retryPassed(function *TestFunction, selector string) bool {
+	name, tag := splitSelector(selector)
+	if name != function.Name {
+		return false
+	}
+	ran := tag == ""
+	for _, incident := range function.Incidents {
+		if tag != "" && incident.DataTag != tag {
+			continue
+		}
+		if incident.Type == "fail" {
+			return false
+		}
+		ran = true
+	}
+	return ran
+}
+
+// retry runs the failing functions again and returns the outcome of each repetition.
+func (r *TestResult) retry(failingFunctions []string, options TestRunOptions, runner RunFunction) ([]retryOutcome, error) {
+	if options.ParallelRetries <= 1 {
+		var outcomes []retryOutcome
+		for repetition := 1; repetition <= options.RepetitionsOnFailure; repetition++ {
+			stillFailing, err := r.runRetry(failingFunctions, runner)
+			if err != nil {
+				return nil, err
+			}
+			for _, function := range failingFunctions {
+				outcomes = append(outcomes, retryOutcome{function, repetition, !stillFailing[function]})
+			}
+		}
+		return outcomes, nil
+	}
+
+	var outcomes []retryOutcome
+	for _, function := range failingFunctions {
+		for repetition := 1; repetition <= options.RepetitionsOnFailure; repetition++ {
+			outcomes = append(outcomes, retryOutcome{function: function, repetition: repetition})
+		}
+	}
+
+	retries := make(chan *retryOutcome)
+	errs := make(chan error, len(outcomes))
+	var workers sync.WaitGroup
+	for worker := 0; worker < options.ParallelRetries; worker++ {
+		workers.Add(1)
+		go func() {
+			defer workers.Done()
+			for outcome := range retries {
+				stillFailing, err := r.runRetry([]string{outcome.function}, runner)
+				if err != nil {
+					errs <- err
+					continue
+				}
+				outcome.passed = !stillFailing[outcome.function]
+			}
+		}()
+	}
+	for i := range outcomes {
+		retries <- &outcomes[i]
+	}
+	close(retries)
+	workers.Wait()
+	close(errs)
+
+	if err := <-errs; err != nil {
+		return nil, err
+	}
+	return outcomes, nil
+}
+
+// runRetry runs the given test functions in one process, with their results written to a
+// file of their own, and returns which of them failed. A function is also considered failed
+// if the process produced no results for it, for example because it crashed.
+func (r *TestResult) runRetry(functions []string, runner RunFunction) (map[string]bool, error) {
+	retryFile, err := ioutil.TempFile(filepath.Dir(r.PathToResultsXML), filepath.Base(r.PathToResultsXML)+".retry")
+	if err != nil {
+		return nil, fmt.Errorf("Error creating temporary file for repeated test output: %s", err)
+	}
+	retryFile.Close()
+	defer os.Remove(retryFile.Name())
+
+	args := append([]string{"-o", retryFile.Name() + ",xml", "-o", "-,txt"}, functions...)
+	if err := runner(args); err != nil {
+		if _, ok := err.(*exec.ExitError); !ok {
+			return nil, err
+		}
+	}
+
+	failed := map[string]bool{}
+	for _, selector := range functions {
+		failed[selector] = true
+	}
+
+	file, err := os.Open(retryFile.Name())
+	if err != nil {
+		return failed, nil
+	}
+	defer file.Close()
+
+	// the results of a crashed process end early, so parse errors only leave the remaining
+	// functions failed.
+	parser := NewTestResultParser(file, ParseOptions{Incidents: true})
+	for parser.Next() {
+		for _, selector := range functions {
+			if retryPassed(parser.Function(), selector) {
+				failed[selector] = false
+			}
+		}
+	}
+	return failed, nil
+}
+
+// recordRetries adds the outcome of each repetition to the repeated test function in the
+// results, as an info message. The messages are inserted at the end of the function in the
+// XML as written by QTestLib, which is otherwise left as it is.
+func (r *TestResult) recordRetries(outcomes []retryOutcome) error {
+	contents, err := ioutil.ReadFile(r.PathToResultsXML)
+	if err != nil {
+		return err
+	}
+
+	repetitions := map[string]int{}
+	for _, outcome := range outcomes {
+		repetitions[outcome.function]++
+	}
+	messages := map[string][]byte{}
+	for _, outcome := range outcomes {
+		name, tag := splitSelector(outcome.function)
+		messages[name] = append(messages[name], repetitionMessageXML(repetitionMessage(outcome, repetitions[outcome.function], tag), tag)...)
+	}
+
+	var patched bytes.Buffer
+	copied := 0
+	decoder := xml.NewDecoder(bytes.NewReader(contents))
+	depth := 0
+	function := ""
+	for {
+		offset := int(decoder.InputOffset())
+		token, err := decoder.RawToken()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return fmt.Errorf("Error decoding %s: %s", r.PathToResultsXML, err)
+		}
+		switch element := token.(type) {
+		case xml.StartElement:
+			depth++
+			if depth == 2 && element.Name.Local == "TestFunction" {
+				function = attributeValue(element, "name")
+			}
+		case xml.EndElement:
+			if depth == 2 && element.Name.Local == "TestFunction" && messages[function] != nil {
+				patched.Write(contents[copied:offset])
+				patched.Write(messages[function])
+				copied = offset
+				delete(messages, function)
+			}
+			depth--
+		}
+	}
+	patched.Write(contents[copied:])
+	return ioutil.WriteFile(r.PathToResultsXML, patched.Bytes(), 0644)
+}
+
+// repetitionMessageXML formats an info message the way QTestLib writes messages, with the data
+// tag of the repeated row if there is one.
+func repetitionMessageXML(description string, tag string) []byte {
+	cdata := func(text string) string {
+		return "<![CDATA[" + strings.Replace(text, "]]>", "]]]]><![CDATA[>", -1) + "]]>"
+	}
+	message := "<Message type=\"info\" file=\"\" line=\"0\">\n"
+	if tag != "" {
+		message += "  <DataTag>" + cdata(tag) + "</DataTag>\n"
+	}
+	message += "  <Description>" + cdata(description) + "</Description>\n</Message>\n"
+	return []byte(message)
+}
+
+func repetitionMessage(outcome retryOutcome, repetitions int, tag string) string {
+	result := "passed"
+	if !outcome.passed {
+		result = "failed"
+	}
+	if tag != "" {
+		return fmt.Sprintf("Repetition %v of %v of data row %s after failure %s", outcome.repetition, repetitions, tag, result)
+	}
+	return fmt.Sprintf("Repetition %v of %v after failure %s", outcome.repetition, repetitions, result)
+}
+
+func failedRetries(outcomes []retryOutcome) []string {
+	var failed []string
+	seen := map[string]bool{}
+	for _, outcome := range outcomes {
+		if !outcome.passed && !seen[outcome.function] {
+			seen[outcome.function] = true
+			failed = append(failed, outcome.function)
+		}
+	}
+	return failed
+}
@@ -45,7 +45,9 @@ import (
 	"io/ioutil"
 	"os"
 	"os/exec"
+	"sort"
 	"strings"
+	"sync"
 	"testing"
 )
 
@@ -83,6 +85,24 @@ func testResultsEqual(left *ParsedTestResult, right *ParsedTestResult) bool {
 	return string(leftBytes) == string(rightBytes)
 }
 
+// withRepetitionMessages returns the result with the messages that record the outcome of
+// repeating its first test function.
+func withRepetitionMessages(result *ParsedTestResult, tag string, outcomes ...string) *ParsedTestResult {
+	recorded := *result
+	recorded.Functions = append([]TestFunction(nil), result.Functions...)
+	for i, outcome := range outcomes {
+		description := fmt.Sprintf("Repetition %v of %v after failure %s", i+1, len(outcomes), outcome)
+		if tag != "" {
+			description = fmt.Sprintf("Repetition %v of %v of data row %s after failure %s", i+1, len(outcomes), tag, outcome)
+		}
+		recorded.Functions[0].Messages = append(recorded.Functions[0].Messages, Message{
+			IncidentHeader: IncidentHeader{Type: "info"},
+			Description:    description,
+		})
+	}
+	return &recorded
+}
+
 func makeTestRunner(t *testing.T, outputToProduce ...*ParsedTestResult) RunFunction {
 	return func(extraArgs []string) error {
 		option := outputOption{}
@@ -194,7 +214,7 @@ func TestFailingOnceTestResult(t *testing.T) {
 		t.FailNow()
 	}
 
-	if !testResultsEqual(actualParsedResult, failingOutput) {
+	if !testResultsEqual(actualParsedResult, withRepetitionMessages(failingOutput, "", "passed", "passed")) {
 		t.Errorf("Unexpected actual  output. Got %v", actualParsedResult)
 		t.FailNow()
 	}
@@ -222,7 +242,7 @@ func TestFailingOnceWithTagTestResult(t *testing.T) {
 		t.Errorf("Incorrect number of failing incidents. Got %v", failingOutput.Functions[0].FailingIncidents())
 		t.FailNow()
 	}
-	if failingOutput.Functions[0].FailingIncidents()[0] != "initTestCase" {
+	if failingOutput.Functions[0].FailingIncidents()[0] != "initTestCase:tag2" {
 		t.Errorf("Incorrect failing tagged incidents. Got %v", failingOutput.Functions[0].FailingIncidents()[0])
 		t.FailNow()
 	}
@@ -256,12 +276,115 @@ func TestFailingOnceWithTagTestResult(t *testing.T) {
 		t.FailNow()
 	}
 
-	if !testResultsEqual(actualParsedResult, failingOutput) {
+	if !testResultsEqual(actualParsedResult, withRepetitionMessages(failingOutput, "tag2", "passed", "passed")) {
 		t.Errorf("Unexpected actual  output. Got %v", actualParsedResult)
 		t.FailNow()
 	}
 }
 
+func TestFailingAgainTestResult(t *testing.T) {
+	failingOutput := &ParsedTestResult{}
+	xml.Unmarshal([]byte(initialXMLOutputToProduce), failingOutput)
+	failingOutput.Functions[0].Incidents[0].Type = "fail"
+
+	passingOutput := &ParsedTestResult{}
+	xml.Unmarshal([]byte(initialXMLOutputToProduce), passingOutput)
+
+	testRunner := makeTestRunner(t, failingOutput, passingOutput, failingOutput)
+
+	result, err := GenerateTestResult("testname", os.TempDir(), 2 /*repetitions*/, testRunner)
+	if err == nil {
+		t.Fatalf("Unexpected test success. Expected error")
+	}
+	if result == nil {
+		t.Fatalf("Unexpected missing test result")
+	}
+
+	actualParsedResult, err := result.Parse()
+	if err != nil {
+		t.Fatalf("Could not read/parse results xml file at %s: %s", result.PathToResultsXML, err)
+	}
+	if !testResultsEqual(actualParsedResult, withRepetitionMessages(failingOutput, "", "passed", "failed")) {
+		t.Errorf("Unexpected actual output. Got %v", actualParsedResult)
+	}
+}
+
+func TestParallelRetries(t *testing.T) {
+	failingOutput := &ParsedTestResult{}
+	xml.Unmarshal([]byte(initialXMLOutputToProduce), failingOutput)
+	failingOutput.Functions[0].Incidents[0].Type = "fail"
+	failingOutput.Functions = append(failingOutput.Functions, TestFunction{Name: "second", Incidents: []Incident{{IncidentHeader: IncidentHeader{Type: "fail"}}}})
+
+	var mutex sync.Mutex
+	var retried []string
+	first := true
+	runner := func(extraArgs []string) error {
+		option := outputOption{}
+		flagSet := flag.NewFlagSet("testlibflagset", flag.PanicOnError)
+		flagSet.Var(&option, "o", "output specifier")
+		if err := flagSet.Parse(extraArgs); err != nil {
+			return err
+		}
+
+		mutex.Lock()
+		output := failingOutput
+		var exitErr error
+		if first {
+			first = false
+			exitErr = &exec.ExitError{}
+		} else {
+			if flagSet.NArg() != 1 {
+				t.Errorf("Expected one function per parallel repetition, got %v", flagSet.Args())
+			}
+			retried = append(retried, flagSet.Args()...)
+			output = &ParsedTestResult{Name: failingOutput.Name}
+			for _, function := range failingOutput.Functions {
+				if function.Name == flagSet.Arg(0) {
+					function.Incidents = []Incident{{IncidentHeader: IncidentHeader{Type: "pass"}}}
+					output.Functions = append(output.Functions, function)
+				}
+			}
+		}
+		mutex.Unlock()
+
+		bytes, err := xml.Marshal(output)
+		if err != nil {
+			return err
+		}
+		if err := ioutil.WriteFile(option.XMLOutputFileName(), bytes, 0644); err != nil {
+			return err
+		}
+		return exitErr
+	}
+
+	result, err := GenerateTestResultWithOptions("testname", os.TempDir(), TestRunOptions{RepetitionsOnFailure: 3, ParallelRetries: 4}, runner)
+	if err != nil {
+		t.Fatalf("Error generating test result: %s", err)
+	}
+
+	sort.Strings(retried)
+	if strings.Join(retried, ",") != "initTestCase,initTestCase,initTestCase,second,second,second" {
+		t.Errorf("Unexpected repetitions %v", retried)
+	}
+
+	actualParsedResult, err := result.Parse()
+	if err != nil {
+		t.Fatalf("Could not read/parse results xml file at %s: %s", result.PathToResultsXML, err)
+	}
+	for _, function := range actualParsedResult.Functions {
+		if len(function.Messages) != 3 {
+			t.Errorf("Expected the outcome of three repetitions for %s, got %v", function.Name, function.Messages)
+		}
+	}
+}
+
+func TestRetrySelectors(t *testing.T) {
+	selectors := retrySelectors([]string{"plain", "rows:row_1", "rows:row-2", "quoted:safe", "quoted:a \"b\"", "quoted:c&d"})
+	if strings.Join(selectors, ",") != "plain,rows:row_1,rows:row-2,quoted" {
+		t.Errorf("Unexpected selectors for repeating %v", selectors)
+	}
+}
+
 func TestFailingNonTestLibTest(t *testing.T) {
 	runner := func([]string) error {
 		// simulate "make check" failing, but we did not write a results .xml file
@@ -279,3 +402,62 @@ func TestFailingNonTestLibTest(t *testing.T) {
 		t.FailNow()
 	}
 }
+
+func TestRecordRetriesKeepsOutput(t *testing.T) {
+	original := `<?xml version="1.0" encoding="UTF-8"?>
+<TestCase name="tst_QIODevice">
+<TestFunction name="read">
+<Message type="qdebug" file="" line="0">
+  <DataTag><![CDATA[small]]></DataTag>
+  <Description><![CDATA[reading & checking]]></Description>
+</Message>
+<Incident type="fail" file="tst_qiodevice.cpp" line="42">
+  <DataTag><![CDATA[small]]></DataTag>
+  <Description><![CDATA[Compared values are not the same]]></Description>
+</Incident>
+<Incident type="pass" file="" line="0">
+  <DataTag><![CDATA[large]]></DataTag>
+</Incident>
+<Duration msecs="0.5"/>
+</TestFunction>
+<TestFunction name="write">
+<Incident type="pass" file="" line="0" />
+<Duration msecs="0.1"/>
+</TestFunction>
+<Duration msecs="1.0"/>
+</TestCase>
+`
+	file, err := ioutil.TempFile("", "recordretries")
+	if err != nil {
+		t.Fatalf("Error creating temporary file: %s", err)
+	}
+	file.Close()
+	defer os.Remove(file.Name())
+	if err := ioutil.WriteFile(file.Name(), []byte(original), 0644); err != nil {
+		t.Fatalf("Error writing results: %s", err)
+	}
+
+	result := &TestResult{TestCaseName: "tst_QIODevice", PathToResultsXML: file.Name()}
+	outcomes := []retryOutcome{{"read:small", 1, true}, {"read:small", 2, false}}
+	if err := result.recordRetries(outcomes); err != nil {
+		t.Fatalf("Error recording repetitions: %s", err)
+	}
+
+	recorded, err := ioutil.ReadFile(file.Name())
+	if err != nil {
+		t.Fatalf("Error reading results: %s", err)
+	}
+	messages := `<Message type="info" file="" line="0">
+  <DataTag><![CDATA[small]]></DataTag>
+  <Description><![CDATA[Repetition 1 of 2 of data row small after failure passed]]></Description>
+</Message>
+<Message type="info" file="" line="0">
+  <DataTag><![CDATA[small]]></DataTag>
+  <Description><![CDATA[Repetition 2 of 2 of data row small after failure failed]]></Description>
+</Message>
+`
+	expected := strings.Replace(original, "<Duration msecs=\"0.5\"/>\n", "<Duration msecs=\"0.5\"/>\n"+messages, 1)
+	if string(recorded) != expected {
+		t.Errorf("Unexpected results after recording repetitions:\n%s", recorded)
+	}
+}
@@ -0,0 +1,363 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"fmt"
+	"math"
+	"math/rand"
+	"sort"
+)
+
+// ComparisonMethod selects the statistical test used by CompareSamples to decide
+// whether the difference between two sets of benchmark samples is significant.
+type ComparisonMethod int
+
+const (
+	// MannWhitneyMethod uses a two-sided Mann-Whitney U test on the raw samples.
+	MannWhitneyMethod ComparisonMethod = iota
+	// BootstrapMethod considers a change significant if the bootstrap confidence
+	// interval of the relative change of the medians does not include zero.
+	BootstrapMethod
+)
+
+// ParseComparisonMethod converts a command line style method name to a ComparisonMethod.
+func ParseComparisonMethod(name string) (ComparisonMethod, error) {
+	switch name {
+	case "mannwhitney":
+		return MannWhitneyMethod, nil
+	case "bootstrap":
+		return BootstrapMethod, nil
+	}
+	return MannWhitneyMethod, fmt.Errorf("Unknown comparison method %s. Valid methods are mannwhitney and bootstrap", name)
+}
+
+// ComparisonOptions controls how CompareSamples classifies a change.
+type ComparisonOptions struct {
+	Method ComparisonMethod
+	// Alpha is the significance level, for example 0.05 for a 95% confidence level.
+	Alpha float64
+	// Threshold is the minimum relative change of the medians, in percent, for a change to be
+	// reported at all. Changes below the threshold are never significant.
+	Threshold float64
+	// BootstrapResamples is the number of resamples used for the confidence interval.
+	BootstrapResamples int
+}
+
+// DefaultComparisonOptions returns the options used when nothing else is specified.
+func DefaultComparisonOptions() ComparisonOptions {
+	return ComparisonOptions{
+		Method:             MannWhitneyMethod,
+		Alpha:              0.05,
+		Threshold:          1.0,
+		BootstrapResamples: 2000,
+	}
+}
+
+// SampleComparison is the result of comparing the samples of an old and a new benchmark run.
+type SampleComparison struct {
+	OldMedian float64
+	NewMedian float64
+	OldMAD    float64
+	NewMAD    float64
+	// Change is the relative change from OldMedian to NewMedian, in percent.
+	Change float64
+	// ConfidenceLow and ConfidenceHigh delimit the bootstrap confidence interval of Change.
+	// They are only valid if Tested is true.
+	ConfidenceLow  float64
+	ConfidenceHigh float64
+	// PValue is the two-sided p-value of the Mann-Whitney U test. Only valid if Tested is true.
+	PValue float64
+	// Tested is false if there were not enough samples on either side for a statistical test,
+	// in which case Significant only reflects the threshold.
+	Tested      bool
+	Significant bool
+}
+
+// Median returns the median of the given samples, or NaN for an empty slice.
+func Median(samples []float64) float64 {
+	if len(samples) == 0 {
+		return math.NaN()
+	}
+	sorted := append([]float64(nil), samples...)
+	sort.Float64s(sorted)
+	return sortedMedian(sorted)
+}
+
+func sortedMedian(sorted []float64) float64 {
+	middle := len(sorted) / 2
+	if len(sorted)%2 == 1 {
+		return sorted[middle]
+	}
+	return (sorted[middle-1] + sorted[middle]) / 2
+}
+
+// MedianAbsoluteDeviation returns the median of the absolute deviations from the median
+// of the given samples. It is a measure of spread that is robust against outliers.
+func MedianAbsoluteDeviation(samples []float64) float64 {
+	if len(samples) == 0 {
+		return math.NaN()
+	}
+	median := Median(samples)
+	deviations := make([]float64, len(samples))
+	for i, sample := range samples {
+		deviations[i] = math.Abs(sample - median)
+	}
+	return Median(deviations)
+}
+
+func relativeChange(oldValue float64, newValue float64) float64 {
+	if oldValue == 0 {
+		if newValue == 0 {
+			return 0
+		}
+		return math.Inf(int(math.Copysign(1, newValue)))
+	}
+	return (newValue - oldValue) / oldValue * 100
+}
+
+// BootstrapConfidenceInterval estimates the (1 - alpha) confidence interval of the relative
+// change of the medians, in percent, by resampling both sides with replacement. The random
+// number generator is seeded deterministically so that repeated comparisons of the same data
+// produce the same interval.
+func BootstrapConfidenceInterval(oldSamples []float64, newSamples []float64, alpha float64, resamples int) (low float64, high float64) {
+	if len(oldSamples) == 0 || len(newSamples) == 0 || resamples <= 0 {
+		return math.NaN(), math.NaN()
+	}
+	random := rand.New(rand.NewSource(1))
+	oldResample := make([]float64, len(oldSamples))
+	newResample := make([]float64, len(newSamples))
+	changes := make([]float64, resamples)
+	for i := range changes {
+		for j := range oldResample {
+			oldResample[j] = oldSamples[random.Intn(len(oldSamples))]
+		}
+		for j := range newResample {
+			newResample[j] = newSamples[random.Intn(len(newSamples))]
+		}
+		sort.Float64s(oldResample)
+		sort.Float64s(newResample)
+		changes[i] = relativeChange(sortedMedian(oldResample), sortedMedian(newResample))
+	}
+	sort.Float64s(changes)
+	percentile := func(p float64) float64 {
+		index := int(math.Floor(p * float64(len(changes)-1)))
+		return changes[index]
+	}
+	return percentile(alpha / 2), percentile(1 - alpha/2)
+}
+
+// MannWhitneyU performs a two-sided Mann-Whitney U test and returns the U statistic of the
+// first sample set together with the p-value. For small samples without ties the exact
+// distribution of U is used, otherwise the tie-corrected normal approximation.
+func MannWhitneyU(first []float64, second []float64) (u float64, p float64) {
+	n1 := len(first)
+	n2 := len(second)
+	if n1 == 0 || n2 == 0 {
+		return math.NaN(), 1
+	}
+
+	type rankedSample struct {
+		value float64
+		first bool
+	}
+	all := make([]rankedSample, 0, n1+n2)
+	for _, v := range first {
+		all = append(all, rankedSample{v, true})
+	}
+	for _, v := range second {
+		all = append(all, rankedSample{v, false})
+	}
+	sort.Slice(all, func(i, j int) bool { return all[i].value < all[j].value })
+
+	rankSum := 0.0
+	tieCorrection := 0.0
+	for i := 0; i < len(all); {
+		j := i
+		for j < len(all) && all[j].value == all[i].value {
+			j++
+		}
+		// ranks are 1-based, tied values get the average rank of their group.
+		averageRank := float64(i+j+1) / 2
+		for k := i; k < j; k++ {
+			if all[k].first {
+				rankSum += averageRank
+			}
+		}
+		ties := float64(j - i)
+		tieCorrection += ties*ties*ties - ties
+		i = j
+	}
+
+	u = rankSum - float64(n1*(n1+1))/2
+	uMin := math.Min(u, float64(n1*n2)-u)
+
+	if tieCorrection == 0 && n1+n2 <= 40 {
+		return u, math.Min(1, 2*exactMannWhitneyCDF(n1, n2, int(uMin)))
+	}
+
+	n := float64(n1 + n2)
+	mean := float64(n1*n2) / 2
+	variance := float64(n1*n2) / 12 * ((n + 1) - tieCorrection/(n*(n-1)))
+	if variance <= 0 {
+		return u, 1
+	}
+	// continuity correction
+	z := (math.Abs(u-mean) - 0.5) / math.Sqrt(variance)
+	if z < 0 {
+		z = 0
+	}
+	return u, math.Min(1, math.Erfc(z/math.Sqrt2))
+}
+
+// exactMannWhitneyCDF returns P(U <= u) for sample sizes n1 and n2 under the null hypothesis,
+// counting the arrangements that produce each value of U.
+func exactMannWhitneyCDF(n1 int, n2 int, u int) float64 {
+	// counts[i][j] holds the distribution of U for sample sizes i and j, indexed by U.
+	counts := make([][][]float64, n1+1)
+	for i := 0; i <= n1; i++ {
+		counts[i] = make([][]float64, n2+1)
+		for j := 0; j <= n2; j++ {
+			distribution := make([]float64, i*j+1)
+			if i == 0 || j == 0 {
+				distribution[0] = 1
+			} else {
+				// the largest value either belongs to the first set, contributing j to U,
+				// or to the second set, contributing nothing.
+				for k := range distribution {
+					if k >= j {
+						distribution[k] += counts[i-1][j][k-j]
+					}
+					if k < len(counts[i][j-1]) {
+						distribution[k] += counts[i][j-1][k]
+					}
+				}
+			}
+			counts[i][j] = distribution
+		}
+	}
+
+	total := 0.0
+	below := 0.0
+	for k, count := range counts[n1][n2] {
+		total += count
+		if k <= u {
+			below += count
+		}
+	}
+	return below / total
+}
+
+// CompareSamples compares the old and new samples of a benchmark and decides whether the
+// change is statistically significant according to the given options. At least two samples
+// on each side are needed for a statistical test. With fewer samples only the threshold is
+// applied and Tested is false.
+func CompareSamples(oldSamples []float64, newSamples []float64, options ComparisonOptions) SampleComparison {
+	result := SampleComparison{
+		OldMedian: Median(oldSamples),
+		NewMedian: Median(newSamples),
+		OldMAD:    MedianAbsoluteDeviation(oldSamples),
+		NewMAD:    MedianAbsoluteDeviation(newSamples),
+		PValue:    1,
+	}
+	result.Change = relativeChange(result.OldMedian, result.NewMedian)
+
+	exceedsThreshold := math.Abs(result.Change) >= options.Threshold && result.Change != 0
+
+	if len(oldSamples) < 2 || len(newSamples) < 2 {
+		result.Significant = exceedsThreshold
+		return result
+	}
+
+	result.Tested = true
+	result.ConfidenceLow, result.ConfidenceHigh = BootstrapConfidenceInterval(oldSamples, newSamples, options.Alpha, options.BootstrapResamples)
+	_, result.PValue = MannWhitneyU(oldSamples, newSamples)
+
+	switch options.Method {
+	case BootstrapMethod:
+		result.Significant = exceedsThreshold && (result.ConfidenceLow > 0 || result.ConfidenceHigh < 0)
+	default:
+		result.Significant = exceedsThreshold && result.PValue < options.Alpha
+	}
+	return result
+}
+
+// Regression returns true if the comparison found a significant change of the metric for
+// the worse.
+func (comparison SampleComparison) Regression(metric string) bool {
+	return comparison.Significant && (comparison.Change > 0) != MetricHigherIsBetter(metric)
+}
+
+// GeometricMean returns the geometric mean of the given positive values, or NaN if there are
+// no values or any of them is not positive. For ratios of new to old results this is the
+// only meaningful average, as it weights a halving and a doubling equally.
+func GeometricMean(values []float64) float64 {
+	if len(values) == 0 {
+		return math.NaN()
+	}
+	sum := 0.0
+	for _, value := range values {
+		if value <= 0 {
+			return math.NaN()
+		}
+		sum += math.Log(value)
+	}
+	return math.Exp(sum / float64(len(values)))
+}
+
+// RatioOutliers marks the ratios that are far away from the bulk of the given ratios. A ratio
+// is an outlier if its logarithm differs from the median of the logarithms by more than
+// factor times the scaled median absolute deviation, and by more than minimumChange percent.
+// The latter avoids reporting every change as an outlier when most ratios are identical.
+func RatioOutliers(ratios []float64, factor float64, minimumChange float64) []bool {
+	outliers := make([]bool, len(ratios))
+	logs := make([]float64, len(ratios))
+	for i, ratio := range ratios {
+		logs[i] = math.Log(ratio)
+	}
+	median := Median(logs)
+	// 1.4826 scales the MAD to be a consistent estimator of the standard deviation.
+	spread := factor * 1.4826 * MedianAbsoluteDeviation(logs)
+	minimumDeviation := math.Log(1 + minimumChange/100)
+	for i, value := range logs {
+		deviation := math.Abs(value - median)
+		outliers[i] = deviation > spread && deviation > minimumDeviation
+	}
+	return outliers
+}
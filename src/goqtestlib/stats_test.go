@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+package goqtestlib
+
+import (
+	"math"
+	"testing"
+)
+
+func TestMedianAndMAD(t *testing.T) {
+	samples := []float64{5, 1, 3, 2, 100}
+	if median := Median(samples); median != 3 {
+		t.Errorf("Unexpected median. Got %v", median)
+	}
+	if mad := MedianAbsoluteDeviation(samples); mad != 2 {
+		t.Errorf("Unexpected median absolute deviation. Got %v", mad)
+	}
+	if median := Median([]float64{4, 1, 3, 2}); median != 2.5 {
+		t.Errorf("Unexpected median for even number of samples. Got %v", median)
+	}
+	if !math.IsNaN(Median(nil)) {
+		t.Errorf("Median of no samples should be NaN")
+	}
+}
+
+func TestMannWhitneyU(t *testing.T) {
+	// completely separated samples of size 5: the exact two-sided p-value is 2/252.
+	u, p := MannWhitneyU([]float64{1, 2, 3, 4, 5}, []float64{6, 7, 8, 9, 10})
+	if u != 0 {
+		t.Errorf("Unexpected U statistic. Got %v", u)
+	}
+	if math.Abs(p-2.0/252.0) > 1e-12 {
+		t.Errorf("Unexpected exact p-value. Got %v", p)
+	}
+
+	_, p = MannWhitneyU([]float64{1, 3, 5, 7, 9}, []float64{2, 4, 6, 8, 10})
+	if p < 0.5 {
+		t.Errorf("Interleaved samples should not be significantly different. Got p=%v", p)
+	}
+
+	// ties force the normal approximation
+	_, p = MannWhitneyU([]float64{1, 1, 2, 2, 3, 3, 4, 4}, []float64{5, 5, 6, 6, 7, 7, 8, 8})
+	if p > 0.01 {
+		t.Errorf("Separated samples with ties should be significantly different. Got p=%v", p)
+	}
+}
+
+func TestCompareSamples(t *testing.T) {
+	options := DefaultComparisonOptions()
+
+	noisy := CompareSamples([]float64{100, 104, 98, 101, 97}, []float64{103, 99, 105, 100, 102}, options)
+	if !noisy.Tested {
+		t.Fatalf("Comparison with five samples on each side should be tested")
+	}
+	if noisy.Significant {
+		t.Errorf("Noise should not be reported as significant: %+v", noisy)
+	}
+
+	regression := CompareSamples([]float64{100, 101, 99, 100, 100.5}, []float64{110, 111, 109, 110.5, 110}, options)
+	if !regression.Significant {
+		t.Errorf("Clear regression should be significant: %+v", regression)
+	}
+	if !regression.Regression("WalltimeMilliseconds") || regression.Regression("BitsPerSecond") {
+		t.Errorf("Longer wall time is a regression, more bits per second is not")
+	}
+	if noisy.Regression("WalltimeMilliseconds") {
+		t.Errorf("Insignificant changes are no regressions")
+	}
+	if regression.ConfidenceLow <= 0 || regression.ConfidenceHigh < regression.ConfidenceLow {
+		t.Errorf("Unexpected confidence interval [%v, %v]", regression.ConfidenceLow, regression.ConfidenceHigh)
+	}
+
+	options.Method = BootstrapMethod
+	if !CompareSamples([]float64{100, 101, 99, 100, 100.5}, []float64{110, 111, 109, 110.5, 110}, options).Significant {
+		t.Errorf("Clear regression should be significant with the bootstrap method")
+	}
+
+	options.Threshold = 20
+	if CompareSamples([]float64{100, 101, 99, 100, 100.5}, []float64{110, 111, 109, 110.5, 110}, options).Significant {
+		t.Errorf("Changes below the threshold should not be significant")
+	}
+
+	single := CompareSamples([]float64{100}, []float64{130}, options)
+	if single.Tested {
+		t.Errorf("Single samples cannot be tested")
+	}
+	if !single.Significant || single.Change != 30 {
+		t.Errorf("Single sample change above threshold should be reported: %+v", single)
+	}
+}
+
+func TestGeometricMean(t *testing.T) {
+	if mean := GeometricMean([]float64{0.5, 2}); math.Abs(mean-1) > 1e-12 {
+		t.Errorf("Halving and doubling should average to 1. Got %v", mean)
+	}
+	if mean := GeometricMean([]float64{2, 8}); math.Abs(mean-4) > 1e-12 {
+		t.Errorf("Unexpected geometric mean. Got %v", mean)
+	}
+	if !math.IsNaN(GeometricMean([]float64{1, 0})) {
+		t.Errorf("Geometric mean of non-positive values should be NaN")
+	}
+}
+
+func TestRatioOutliers(t *testing.T) {
+	ratios := []float64{1.0, 1.01, 0.99, 1.02, 0.98, 4.0}
+	outliers := RatioOutliers(ratios, 3, 1)
+	for i, outlier := range outliers {
+		if outlier != (i == len(ratios)-1) {
+			t.Errorf("Unexpected outlier classification for ratio %v: %v", ratios[i], outlier)
+		}
+	}
+
+	// identical ratios have no spread, only changes above the minimum count as outliers.
+	outliers = RatioOutliers([]float64{1, 1, 1, 1.005, 1.5}, 3, 1)
+	if outliers[3] || !outliers[4] {
+		t.Errorf("Unexpected outlier classification without spread: %v", outliers)
+	}
+}
@@ -0,0 +1,133 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+package main
+
+import (
+	"fmt"
+	"log"
+	"os"
+	"path/filepath"
+	"regexp"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// foldedStacks returns the folded stacks of all profiled repetitions of a test in the archive.
+func (archive *testArchive) foldedStacks(test string) (goqtestlib.FoldedStacks, error) {
+	stacks := goqtestlib.FoldedStacks{}
+	for _, f := range archive.reader.File {
+		if name, _, ok := goqtestlib.SplitProfileFileName(f.Name, "folded"); !ok || name != test {
+			continue
+		}
+		reader, err := f.Open()
+		if err != nil {
+			return nil, err
+		}
+		err = stacks.Read(reader)
+		reader.Close()
+		if err != nil {
+			return nil, fmt.Errorf("Error reading %s: %s", f.Name, err)
+		}
+	}
+	return stacks, nil
+}
+
+var unsafeFileNameCharacters = regexp.MustCompile(`[^A-Za-z0-9._-]+`)
+
+// writeDifferentialFlameGraphs writes the input for a differential flame graph for every
+// regressed benchmark, from the perf profiles recorded with benchmarkrunner -profile perf.
+// Only the stacks that pass through the benchmark function are included. Data tags of the
+// same function cannot be told apart in the profile.
+func writeDifferentialFlameGraphs(dir string, oarch string, narch string, rows []comparisonRow) error {
+	or, err := openTestArchive(oarch)
+	if err != nil {
+		return err
+	}
+	defer or.Close()
+
+	nr, err := openTestArchive(narch)
+	if err != nil {
+		return err
+	}
+	defer nr.Close()
+
+	if err := os.MkdirAll(dir, 0755); err != nil {
+		return err
+	}
+
+	written := map[goqtestlib.BenchmarkID]bool{}
+	for _, row := range rows {
+		benchmark := row.Result.Benchmark
+		if row.Comparison == nil || !row.Comparison.Regression(row.Metric) || written[benchmark] {
+			continue
+		}
+		written[benchmark] = true
+
+		oldStacks, err := or.foldedStacks(benchmark.Test)
+		if err != nil {
+			return err
+		}
+		newStacks, err := nr.foldedStacks(benchmark.Test)
+		if err != nil {
+			return err
+		}
+		if len(oldStacks) == 0 || len(newStacks) == 0 {
+			log.Printf("Warning: No profiles of %s found, run benchmarkrunner with -profile perf", benchmark.Test)
+			continue
+		}
+
+		function := row.Result.TestCase + "::" + benchmark.Function + "("
+		oldStacks = oldStacks.Filter(function)
+		newStacks = newStacks.Filter(function)
+
+		path := filepath.Join(dir, unsafeFileNameCharacters.ReplaceAllString(benchmark.String(), "_")+".difffolded")
+		output, err := os.Create(path)
+		if err != nil {
+			return err
+		}
+		err = goqtestlib.WriteDifferentialFoldedStacks(output, oldStacks, newStacks)
+		output.Close()
+		if err != nil {
+			return err
+		}
+		log.Printf("Wrote differential flame graph input for %s to %s", benchmark, path)
+	}
+	return nil
+}
@@ -0,0 +1,100 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+package main
+
+import (
+	"fmt"
+	"io"
+	"log"
+	"os"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+	"github.com/olekukonko/tablewriter"
+)
+
+// reportChangePoints prints the step changes found in each benchmark series of the
+// result history, together with the commit that introduced them.
+func reportChangePoints(output io.Writer, series []goqtestlib.HistorySeries, metrics []string, options goqtestlib.ChangePointOptions) {
+	wantedMetrics := map[string]bool{}
+	for _, metric := range metrics {
+		wantedMetrics[metric] = true
+	}
+
+	table := tablewriter.NewWriter(output)
+	table.SetHeader([]string{"Benchmark", "Metric", "Commit", "Before", "After", "Change", "p"})
+
+	found := 0
+	for _, s := range series {
+		if len(wantedMetrics) > 0 && !wantedMetrics[s.Metric] {
+			continue
+		}
+		unit := goqtestlib.MetricUnit(s.Metric)
+		for _, cp := range goqtestlib.DetectChangePoints(s.Values, options) {
+			found++
+			table.Append([]string{
+				s.Benchmark,
+				s.Metric,
+				s.Commits[cp.Index],
+				describeSamples([]float64{cp.Before}, unit),
+				describeSamples([]float64{cp.After}, unit),
+				describeChange(s.Metric, goqtestlib.SampleComparison{OldMedian: cp.Before, NewMedian: cp.After, Change: cp.Change, Significant: true}),
+				fmt.Sprintf("%.3f", cp.PValue),
+			})
+		}
+	}
+
+	if found == 0 {
+		fmt.Fprintf(output, "No changes found in %d benchmark series\n", len(series))
+		return
+	}
+	table.Render()
+}
+
+func analyzeHistory(path string, metrics []string, options goqtestlib.ChangePointOptions) {
+	fmt.Printf("Looking for changes in result history %s\n", path)
+
+	history := goqtestlib.ResultHistory{Path: path}
+	records, err := history.Records()
+	if err != nil {
+		log.Fatalf("Can't read result history: %s\n", err)
+	}
+
+	reportChangePoints(os.Stdout, goqtestlib.Series(records), metrics, options)
+}
@@ -41,36 +41,50 @@ package main
 
 import (
 	"archive/zip"
-	"encoding/xml"
+	"bytes"
+	"encoding/json"
 	"flag"
 	"fmt"
 	"io"
 	"io/ioutil"
 	"log"
 	"os"
+	"path"
+	"runtime"
 	"sort"
 	"strconv"
+	"strings"
 
 	"code.qt.io/qt/qtqa.git/src/goqtestlib"
 	"github.com/olekukonko/tablewriter"
 )
 
 func loadTestResult(path string) *goqtestlib.ParsedTestResult {
-	tr := goqtestlib.TestResult{PathToResultsXML: path}
-	r, err := tr.Parse()
+	file, err := os.Open(path)
 	if err != nil {
 		log.Fatalf("Can't open result at path %s: %s", path, err)
 	}
+	defer file.Close()
+
+	r, err := goqtestlib.ParseBenchmarkResults(file)
+	if err != nil {
+		log.Fatalf("Can't read result at path %s: %s", path, err)
+	}
 
 	return r
 }
 
+// MetricSamples holds the values of one benchmark metric measured in the old and new runs.
+type MetricSamples struct {
+	Old []float64
+	New []float64
+}
+
 type MergedTestResult struct {
-	Name                string
-	OldDuration         *float64
-	NewDuration         *float64
-	OldInstructionReads *float64
-	NewInstructionReads *float64
+	Name      string
+	TestCase  string
+	Benchmark goqtestlib.BenchmarkID
+	Metrics   map[string]*MetricSamples
 }
 
 type ByName []MergedTestResult
@@ -83,21 +97,57 @@ func (s ByName) Less(i int, j int) bool {
 	return s[i].Name < s[j].Name
 }
 
-func describeChange(pChange float64) string {
+func formatPercentage(pChange float64) string {
 	pStr := strconv.FormatFloat(pChange, 'f', 2, 64)
 	if pChange > 0 {
-		return fmt.Sprintf("+%s%%", pStr)
-	} else if pChange < 0 {
-		return fmt.Sprintf("%s%% FASTER! :)", pStr)
+		return "+" + pStr + "%"
+	}
+	return pStr + "%"
+}
+
+func describeChange(metric string, comparison goqtestlib.SampleComparison) string {
+	description := ""
+	if !comparison.Significant {
+		description = "more or less the same"
+		if comparison.Change != 0 {
+			description += " (" + formatPercentage(comparison.Change) + ")"
+		}
+	} else if (comparison.Change > 0) != goqtestlib.MetricHigherIsBetter(metric) {
+		description = formatPercentage(comparison.Change)
 	} else {
-		return "more or less the same"
+		description = formatPercentage(comparison.Change) + " BETTER! :)"
+	}
+
+	if comparison.Tested {
+		description += fmt.Sprintf(" [%s, %s] p=%.3f", formatPercentage(comparison.ConfidenceLow), formatPercentage(comparison.ConfidenceHigh), comparison.PValue)
+	}
+	return description
+}
+
+// describeSamples formats the median of the samples, followed by the median absolute deviation
+// and the number of samples if the benchmark was repeated.
+func describeSamples(samples []float64, unit string) string {
+	median := goqtestlib.Median(samples)
+	description := strconv.FormatFloat(median, 'f', 2, 64)
+	if len(samples) > 1 {
+		description += " ±" + strconv.FormatFloat(goqtestlib.MedianAbsoluteDeviation(samples), 'f', 2, 64)
+	}
+	description += " " + unit
+	if len(samples) > 1 {
+		description += fmt.Sprintf(" (n=%v)", len(samples))
 	}
+	return description
 }
 
 type MergedTestResults map[string]MergedTestResult
 
-func (results *MergedTestResults) addOldTestCase(prefix string, testCase *goqtestlib.ParsedTestResult) {
-	// XXX: add a way to specify what type of benchmarkresult to look for.
+func (results *MergedTestResults) addTestCase(prefix string, testCase *goqtestlib.ParsedTestResult, samples func(*MetricSamples) *[]float64) {
+	// archived results are identified by their name in the archive, like benchmarkrunner
+	// does, single results by the name of the test case.
+	test := strings.TrimSuffix(prefix, ".xml/")
+	if test == "" {
+		test = testCase.Name
+	}
 	for _, fn := range testCase.Functions {
 		qualifiedName := prefix + fn.Name
 		for _, br := range fn.BenchmarkResults {
@@ -107,124 +157,178 @@ func (results *MergedTestResults) addOldTestCase(prefix string, testCase *goqtes
 			}
 			res := (*results)[nameWithTag]
 			res.Name = nameWithTag
-			val := br.Value
-			if br.Metric == "WalltimeMilliseconds" {
-				res.OldDuration = &val
-			} else if br.Metric == "InstructionReads" {
-				res.OldInstructionReads = &val
+			res.TestCase = testCase.Name
+			res.Benchmark = goqtestlib.BenchmarkID{Test: test, Function: fn.Name, Tag: br.Tag}
+			if res.Metrics == nil {
+				res.Metrics = map[string]*MetricSamples{}
+			}
+			metricSamples := res.Metrics[br.Metric]
+			if metricSamples == nil {
+				metricSamples = &MetricSamples{}
+				res.Metrics[br.Metric] = metricSamples
 			}
+			values := samples(metricSamples)
+			*values = append(*values, br.Value)
 			(*results)[nameWithTag] = res
 		}
 	}
 }
 
+func (results *MergedTestResults) addOldTestCase(prefix string, testCase *goqtestlib.ParsedTestResult) {
+	results.addTestCase(prefix, testCase, func(s *MetricSamples) *[]float64 { return &s.Old })
+}
+
 func (results *MergedTestResults) addNewTestCase(prefix string, testCase *goqtestlib.ParsedTestResult) {
-	for _, fn := range testCase.Functions {
-		qualifiedName := prefix + fn.Name
-		for _, br := range fn.BenchmarkResults {
-			nameWithTag := qualifiedName
-			if br.Tag != "" {
-				nameWithTag += ":" + br.Tag
-			}
-			res := (*results)[nameWithTag]
-			res.Name = nameWithTag
-			val := br.Value
-			if br.Metric == "WalltimeMilliseconds" {
-				res.NewDuration = &val
-			} else if br.Metric == "InstructionReads" {
-				res.NewInstructionReads = &val
-			}
-			(*results)[nameWithTag] = res
+	results.addTestCase(prefix, testCase, func(s *MetricSamples) *[]float64 { return &s.New })
+}
+
+// metrics returns the sorted names of all metrics found in the results.
+func (results *MergedTestResults) metrics() []string {
+	found := map[string]bool{}
+	for _, mr := range *results {
+		for metric := range mr.Metrics {
+			found[metric] = true
 		}
 	}
+	metrics := []string{}
+	for metric := range found {
+		metrics = append(metrics, metric)
+	}
+	sort.Strings(metrics)
+	return metrics
+}
+
+// comparisonRow holds the comparison of one metric of one benchmark. Comparison is nil if
+// the metric wasn't measured in both runs.
+type comparisonRow struct {
+	Result     MergedTestResult
+	Metric     string
+	Samples    MetricSamples
+	Comparison *goqtestlib.SampleComparison
 }
 
-func (results *MergedTestResults) compare(output io.Writer) {
+// compare compares all merged results, with one row per benchmark and metric, sorted by the
+// name of the benchmark. Only changes that are significant according to options are reported
+// as such.
+func (results *MergedTestResults) compare(metrics []string, options goqtestlib.ComparisonOptions) []comparisonRow {
 	// convert mergedResults to a slice, and sort it for stable results.
 	sortedResults := []MergedTestResult{}
-
 	for _, mr := range *results {
 		sortedResults = append(sortedResults, mr)
 	}
-
 	sort.Sort(ByName(sortedResults))
 
-	table := tablewriter.NewWriter(output)
-	table.SetAutoFormatHeaders(false)
-	table.SetHeader([]string{"Test", "From", "To", "Details"})
-	table.SetBorder(false)
-
-	totalPChange := 0.0
-
+	rows := []comparisonRow{}
 	for _, mr := range sortedResults {
-		row := []string{}
-		row = append(row, mr.Name)
-
-		if mr.OldInstructionReads != nil && mr.NewInstructionReads != nil {
-			pChange := (*mr.NewInstructionReads - *mr.OldInstructionReads) / *mr.OldInstructionReads * 100
-			totalPChange += pChange
-			row = append(row, strconv.FormatFloat(*mr.OldInstructionReads, 'f', 2, 64)+" instr")
-			row = append(row, strconv.FormatFloat(*mr.NewInstructionReads, 'f', 2, 64)+" instr")
-			row = append(row, describeChange(pChange))
-
-		} else if mr.OldDuration != nil && mr.NewDuration != nil {
-			pChange := (*mr.NewDuration - *mr.OldDuration) / *mr.OldDuration * 100
-			totalPChange += pChange
-			row = append(row, strconv.FormatFloat(*mr.OldDuration, 'f', 2, 64)+" ms")
-			row = append(row, strconv.FormatFloat(*mr.NewDuration, 'f', 2, 64)+" ms")
-			row = append(row, describeChange(pChange))
-		} else {
-			// the comparison can't be made because either the data types are
-			// differing between the two runs, or we're missing a test in one
-			// run.
-			//
-			// try find something to display for old and new. fall back to "-"
-			// if we can't.
-			ostr := "-"
-			nstr := "-"
-
-			if mr.OldDuration != nil {
-				ostr = strconv.FormatFloat(*mr.OldDuration, 'f', 2, 64) + " ms"
-			} else if mr.OldInstructionReads != nil {
-				ostr = strconv.FormatFloat(*mr.OldInstructionReads, 'f', 2, 64) + " instr"
+		for _, metric := range metrics {
+			samples := mr.Metrics[metric]
+			if samples == nil {
+				continue
 			}
-
-			if mr.NewDuration != nil {
-				nstr = strconv.FormatFloat(*mr.NewDuration, 'f', 2, 64) + " ms"
-			} else if mr.NewInstructionReads != nil {
-				nstr = strconv.FormatFloat(*mr.NewInstructionReads, 'f', 2, 64) + " instr"
+			row := comparisonRow{Result: mr, Metric: metric, Samples: *samples}
+			if samples.Old != nil && samples.New != nil {
+				comparison := goqtestlib.CompareSamples(samples.Old, samples.New, options)
+				row.Comparison = &comparison
 			}
-
-			row = append(row, ostr)
-			row = append(row, nstr)
-			row = append(row, "-")
+			rows = append(rows, row)
 		}
+	}
+	return rows
+}
 
-		table.Append(row)
+// renderTable prints the rows as a table to output, with one group of columns per metric,
+// followed by the overall result.
+func renderTable(output io.Writer, rows []comparisonRow, metrics []string, summary *overallSummary, threshold float64) {
+	header := []string{"Test"}
+	for _, metric := range metrics {
+		header = append(header, metric+" from", "to", "details")
 	}
 
-	verdict := ""
-	totalPStr := strconv.FormatFloat(totalPChange, 'f', 2, 64)
-	if totalPChange > 0 {
-		verdict = fmt.Sprintf("+%s%% :(", totalPStr)
-	} else if totalPChange < 0 {
-		verdict = fmt.Sprintf("%s%% :)", totalPStr)
-	} else {
-		verdict = "more or less the same"
+	table := tablewriter.NewWriter(output)
+	table.SetAutoFormatHeaders(false)
+	table.SetHeader(header)
+	table.SetBorder(false)
+
+	for begin := 0; begin < len(rows); {
+		mr := rows[begin].Result
+		end := begin
+		byMetric := map[string]comparisonRow{}
+		for ; end < len(rows) && rows[end].Result.Name == mr.Name; end++ {
+			byMetric[rows[end].Metric] = rows[end]
+		}
+		begin = end
+
+		line := []string{mr.Name}
+		for _, metric := range metrics {
+			unit := goqtestlib.MetricUnit(metric)
+			row, ok := byMetric[metric]
+
+			if ok && row.Comparison != nil {
+				line = append(line, describeSamples(row.Samples.Old, unit))
+				line = append(line, describeSamples(row.Samples.New, unit))
+				line = append(line, describeChange(metric, *row.Comparison))
+			} else {
+				// the comparison can't be made because either the metric was
+				// not measured for this test, or we're missing a test in one
+				// run.
+				//
+				// show what we have for old and new. fall back to "-" if we
+				// can't.
+				ostr := "-"
+				nstr := "-"
+
+				if ok && row.Samples.Old != nil {
+					ostr = describeSamples(row.Samples.Old, unit)
+				}
+
+				if ok && row.Samples.New != nil {
+					nstr = describeSamples(row.Samples.New, unit)
+				}
+
+				line = append(line, ostr)
+				line = append(line, nstr)
+				line = append(line, "-")
+			}
+		}
+
+		table.Append(line)
 	}
 
-	table.SetFooter([]string{"Overall result", "", "", verdict})
 	table.Render()
 
+	summary.render(output, threshold)
 }
 
-func compareSingleTestRuns(oxml string, nxml string) {
+// suspiciousBenchmarks returns the benchmarks with a significant change of any metric, for
+// confirming them with more repetitions.
+func suspiciousBenchmarks(rows []comparisonRow) []goqtestlib.BenchmarkID {
+	var suspicious []goqtestlib.BenchmarkID
+	seen := map[goqtestlib.BenchmarkID]bool{}
+	for _, row := range rows {
+		if row.Comparison != nil && row.Comparison.Significant && !seen[row.Result.Benchmark] {
+			seen[row.Result.Benchmark] = true
+			suspicious = append(suspicious, row.Result.Benchmark)
+		}
+	}
+	return suspicious
+}
+
+// writeSuspiciousBenchmarks writes the benchmarks to a file, one per line, in the format
+// benchmarkrunner -select reads.
+func writeSuspiciousBenchmarks(path string, benchmarks []goqtestlib.BenchmarkID) error {
+	var contents bytes.Buffer
+	for _, benchmark := range benchmarks {
+		fmt.Fprintln(&contents, benchmark)
+	}
+	return ioutil.WriteFile(path, contents.Bytes(), 0644)
+}
+
+func loadSingleTestRuns(oxml string, nxml string) MergedTestResults {
 	oldTest := loadTestResult(oxml)
 	newTest := loadTestResult(nxml)
 
 	if oldTest.Name != newTest.Name {
 		log.Fatalf("I can't compare two totally different things (old: %s, new: %s)", oldTest.Name, newTest.Name)
-		return
 	}
 
 	// merge the test functions into a singular representation.
@@ -233,21 +337,16 @@ func compareSingleTestRuns(oxml string, nxml string) {
 	mergedResults.addOldTestCase(prefix, oldTest)
 	mergedResults.addNewTestCase(prefix, newTest)
 
-	mergedResults.compare(os.Stdout)
+	return mergedResults
 }
 
-func unmarshalTestResult(reader io.ReadCloser) (*goqtestlib.ParsedTestResult, error) {
-	defer reader.Close()
-	xmlContents, err := ioutil.ReadAll(reader)
+func readTestResult(f *zip.File) (*goqtestlib.ParsedTestResult, error) {
+	reader, err := f.Open()
 	if err != nil {
-		return nil, fmt.Errorf("Error reading results xml file: %s", err)
+		return nil, fmt.Errorf("Error opening entry in zip archive: %s", err)
 	}
-
-	testCase := &goqtestlib.ParsedTestResult{}
-	if err = xml.Unmarshal(xmlContents, &testCase); err != nil {
-		return nil, fmt.Errorf("Error unmarshalling testlib xml output: %s", err)
-	}
-	return testCase, nil
+	defer reader.Close()
+	return goqtestlib.ParseBenchmarkResults(reader)
 }
 
 type testArchive struct {
@@ -259,30 +358,158 @@ func openTestArchive(path string) (*testArchive, error) {
 	return &testArchive{reader}, err
 }
 
+// resultsTable returns the results table stored in the archive, or nil if there is none or it
+// doesn't match the XML entries. Entries may have been added to or replaced in the archive by
+// something else after the table was written, so the table must list exactly the same XML
+// files with the same sizes and checksums.
+func (archive *testArchive) resultsTable(entries []*zip.File) *goqtestlib.ResultsTable {
+	var tableEntry *zip.File
+	for _, f := range archive.reader.File {
+		if f.Name == goqtestlib.ResultsTableFileName {
+			tableEntry = f
+		}
+	}
+	if tableEntry == nil {
+		return nil
+	}
+
+	reader, err := tableEntry.Open()
+	if err != nil {
+		log.Printf("Warning: Cannot open results table: %s", err)
+		return nil
+	}
+	defer reader.Close()
+	table, err := goqtestlib.ReadResultsTable(reader)
+	if err != nil {
+		log.Printf("Warning: %s, reading the XML results instead", err)
+		return nil
+	}
+
+	var files []goqtestlib.ResultsFile
+	for _, entry := range entries {
+		files = append(files, goqtestlib.ResultsFile{Name: entry.Name, Size: entry.UncompressedSize64, CRC32: entry.CRC32})
+	}
+	if !table.Covers(files) {
+		return nil
+	}
+	return table
+}
+
+// forEachTestCase decodes the test results in the archive concurrently, with one goroutine
+// per CPU, and calls the callback for each of them in archive order. Entries that cannot be
+// decoded are skipped with a warning. If the archive has an up to date results table, the
+// results are taken from it instead of decoding the XML.
 func (archive *testArchive) forEachTestCase(callback func(path string, testCase *goqtestlib.ParsedTestResult) error) error {
+	var entries []*zip.File
 	for _, f := range archive.reader.File {
-		reader, err := f.Open()
-		if err != nil {
-			log.Fatalf("Error opening entry in zip archive %s: %s", f.Name, err)
+		if path.Ext(f.Name) == ".xml" {
+			entries = append(entries, f)
 		}
-		result, err := unmarshalTestResult(reader)
-		if err != nil {
-			log.Fatalf("Error unpacking test result for %s from zip archive: %s", f.Name, err)
+	}
+
+	if table := archive.resultsTable(entries); table != nil {
+		return table.ForEachTestCase(callback)
+	}
+
+	type decodedEntry struct {
+		result *goqtestlib.ParsedTestResult
+		err    error
+		done   chan struct{}
+	}
+	decoded := make([]decodedEntry, len(entries))
+	for i := range decoded {
+		decoded[i].done = make(chan struct{})
+	}
+
+	indices := make(chan int)
+	stop := make(chan struct{})
+	defer close(stop)
+
+	go func() {
+		defer close(indices)
+		for i := range entries {
+			select {
+			case indices <- i:
+			case <-stop:
+				return
+			}
+		}
+	}()
+
+	for worker := 0; worker < runtime.NumCPU(); worker++ {
+		go func() {
+			for i := range indices {
+				decoded[i].result, decoded[i].err = readTestResult(entries[i])
+				close(decoded[i].done)
+			}
+		}()
+	}
+
+	for i, entry := range entries {
+		<-decoded[i].done
+		if decoded[i].err != nil {
+			log.Printf("Warning: Skipping test result %s from zip archive: %s", entry.Name, decoded[i].err)
+			continue
 		}
-		if err := callback(f.Name, result); err != nil {
+		if err := callback(entry.Name, decoded[i].result); err != nil {
 			return err
 		}
+		decoded[i].result = nil
 	}
 	return nil
 }
 
+// environment returns the description of the environment the archived results were recorded
+// in, or nil if the archive doesn't contain one.
+func (archive *testArchive) environment() (*goqtestlib.BenchmarkEnvironment, error) {
+	for _, f := range archive.reader.File {
+		if f.Name != goqtestlib.BenchmarkEnvironmentFileName {
+			continue
+		}
+		reader, err := f.Open()
+		if err != nil {
+			return nil, err
+		}
+		defer reader.Close()
+		environment := &goqtestlib.BenchmarkEnvironment{}
+		if err := json.NewDecoder(reader).Decode(environment); err != nil {
+			return nil, fmt.Errorf("Error reading %s: %s", f.Name, err)
+		}
+		return environment, nil
+	}
+	return nil, nil
+}
+
+// warnAboutEnvironmentDifferences prints a warning if the two archives were recorded in
+// environments that make their results incomparable.
+func warnAboutEnvironmentDifferences(or *testArchive, nr *testArchive) {
+	oldEnvironment, err := or.environment()
+	if err != nil {
+		log.Printf("Warning: %s", err)
+	}
+	newEnvironment, err := nr.environment()
+	if err != nil {
+		log.Printf("Warning: %s", err)
+	}
+	if oldEnvironment == nil || newEnvironment == nil {
+		if oldEnvironment != newEnvironment {
+			log.Printf("Warning: Only one of the archives describes its environment, the results may not be comparable")
+		}
+		return
+	}
+	if differences := oldEnvironment.Differences(newEnvironment); len(differences) > 0 {
+		log.Printf("Warning: The results were recorded in different environments and may not be comparable:")
+		for _, difference := range differences {
+			log.Printf("    %s", difference)
+		}
+	}
+}
+
 func (archive *testArchive) Close() error {
 	return archive.reader.Close()
 }
 
-func compareArchivedTestRuns(oarch string, narch string) {
-	fmt.Printf("Comparing zipped runs %s vs %s\n", oarch, narch)
-
+func loadArchivedTestRuns(oarch string, narch string) MergedTestResults {
 	or, err := openTestArchive(oarch)
 	if err != nil {
 		log.Fatalf("Can't open old archive: %s\n", err)
@@ -295,20 +522,26 @@ func compareArchivedTestRuns(oarch string, narch string) {
 	}
 	defer nr.Close()
 
+	warnAboutEnvironmentDifferences(or, nr)
+
 	// this is a map of xml to result, so e.g:
 	// qml/binding.xml -> result.
 	mergedResults := MergedTestResults{}
 
+	// repeated runs of the same benchmark share their prefix, so that their
+	// results are merged into one set of samples.
 	or.forEachTestCase(func(path string, testCase *goqtestlib.ParsedTestResult) error {
-		mergedResults.addOldTestCase(path+"/", testCase)
+		name, _ := goqtestlib.SplitRepetitionFileName(path)
+		mergedResults.addOldTestCase(name+".xml/", testCase)
 		return nil
 	})
 	nr.forEachTestCase(func(path string, testCase *goqtestlib.ParsedTestResult) error {
-		mergedResults.addNewTestCase(path+"/", testCase)
+		name, _ := goqtestlib.SplitRepetitionFileName(path)
+		mergedResults.addNewTestCase(name+".xml/", testCase)
 		return nil
 	})
 
-	mergedResults.compare(os.Stdout)
+	return mergedResults
 }
 
 func main() {
@@ -317,8 +550,49 @@ func main() {
 
 	var na = flag.String("newarchive", "", "the changed archived results to compare against")
 	var oa = flag.String("oldarchive", "", "the baseline archived results to compare against")
+
+	var metricList = flag.String("metrics", "", "comma separated list of benchmark metrics to compare, such as WalltimeMilliseconds,CPUCycles. Defaults to all metrics found")
+	var method = flag.String("method", "mannwhitney", "the significance test for repeated benchmark runs: mannwhitney or bootstrap")
+	var alpha = flag.Float64("alpha", 0.05, "the significance level for reporting a change")
+	var threshold = flag.Float64("threshold", 1.0, "the minimum change in percent for reporting a change")
+	var outlierFactor = flag.Float64("outlier-factor", 3.0, "exclude changes further than this many (MAD based) standard deviations from the median change from the overall result")
+	var suspiciousOut = flag.String("suspicious-out", "", "write the significantly changed benchmarks to this file, for running them again with benchmarkrunner -select")
+	var format = flag.String("format", "table", "the output format: table, json, csv or junit")
+	var failThreshold = flag.Float64("fail-threshold", 0, "exit with status 3 if a benchmark regressed significantly by at least this many percent. 0 disables the check")
+	var failGeometricMean = flag.Float64("fail-geomean", 0, "exit with status 3 if the geometric mean of a metric over all test cases regressed by at least this many percent. 0 disables the check")
+	var flameGraphDir = flag.String("flamegraph-dir", "", "write differential flame graph input for every regressed benchmark into this directory, from archives recorded with benchmarkrunner -profile perf")
+	var historyFile = flag.String("history", "", "look for step changes in a result history recorded with benchmarkrunner -history-file instead of comparing two runs")
 	flag.Parse()
 
+	options := goqtestlib.DefaultComparisonOptions()
+	var err error
+	if options.Method, err = goqtestlib.ParseComparisonMethod(*method); err != nil {
+		log.Fatalf("%s", err)
+	}
+	options.Alpha = *alpha
+	options.Threshold = *threshold
+
+	metrics := []string{}
+	if *metricList != "" {
+		metrics = strings.Split(*metricList, ",")
+	}
+
+	if *historyFile != "" {
+		// change points need stricter defaults than a pairwise comparison, as many
+		// positions are tested. Only explicitly given values override them.
+		historyOptions := goqtestlib.DefaultChangePointOptions()
+		flag.Visit(func(f *flag.Flag) {
+			switch f.Name {
+			case "alpha":
+				historyOptions.Alpha = *alpha
+			case "threshold":
+				historyOptions.Threshold = *threshold
+			}
+		})
+		analyzeHistory(*historyFile, metrics, historyOptions)
+		return
+	}
+
 	nxml := *nf
 	oxml := *of
 
@@ -332,13 +606,66 @@ func main() {
 	hasOldArch := len(oarch) > 0
 
 	if (!hasNewFile || !hasOldFile) && (!hasNewArch || !hasOldArch) {
-		log.Fatalf("You need to provide either -new & -old, or -newarchive & -oldarchive.")
+		log.Fatalf("You need to provide either -new & -old, -newarchive & -oldarchive, or -history.")
 		return
 	}
 
+	writeReport, ok := reportWriters[*format]
+	if !ok {
+		log.Fatalf("Unknown output format %s, use table, json, csv or junit", *format)
+	}
+
+	var mergedResults MergedTestResults
 	if hasNewFile && hasOldFile {
-		compareSingleTestRuns(oxml, nxml)
+		mergedResults = loadSingleTestRuns(oxml, nxml)
 	} else {
-		compareArchivedTestRuns(oarch, narch)
+		if *format == "table" {
+			fmt.Printf("Comparing zipped runs %s vs %s\n", oarch, narch)
+		}
+		mergedResults = loadArchivedTestRuns(oarch, narch)
+	}
+
+	if len(metrics) == 0 {
+		metrics = mergedResults.metrics()
+	}
+	rows := mergedResults.compare(metrics, options)
+
+	report := report{
+		rows:              rows,
+		metrics:           metrics,
+		options:           options,
+		failThreshold:     *failThreshold,
+		failGeometricMean: *failGeometricMean,
+	}
+	report.summary = report.summarize(*outlierFactor)
+	if err := writeReport(os.Stdout, &report); err != nil {
+		log.Fatalf("Can't write report: %s", err)
+	}
+
+	if *suspiciousOut != "" {
+		if err := writeSuspiciousBenchmarks(*suspiciousOut, suspiciousBenchmarks(rows)); err != nil {
+			log.Fatalf("Can't write suspicious benchmarks: %s", err)
+		}
+	}
+
+	if *flameGraphDir != "" {
+		if !hasOldArch || !hasNewArch {
+			log.Fatalf("Differential flame graphs need profiles from -oldarchive and -newarchive")
+		}
+		if err := writeDifferentialFlameGraphs(*flameGraphDir, oarch, narch, rows); err != nil {
+			log.Fatalf("Can't write differential flame graphs: %s", err)
+		}
+	}
+
+	failures := report.failures()
+	for _, row := range failures {
+		log.Printf("Regression: %s %s %s", row.Result.Name, row.Metric, formatPercentage(row.Comparison.Change))
+	}
+	meanFailures := report.geometricMeanFailures()
+	for _, mean := range meanFailures {
+		log.Printf("Regression: geometric mean of %s over all test cases %s", mean.Metric, formatPercentage(mean.change()))
+	}
+	if len(failures) > 0 || len(meanFailures) > 0 {
+		os.Exit(3)
 	}
 }
@@ -0,0 +1,377 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+package main
+
+import (
+	"encoding/csv"
+	"encoding/json"
+	"encoding/xml"
+	"fmt"
+	"io"
+	"math"
+	"strconv"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+)
+
+// report holds everything needed to write the comparison in one of the output formats.
+type report struct {
+	rows              []comparisonRow
+	metrics           []string
+	options           goqtestlib.ComparisonOptions
+	summary           *overallSummary
+	failThreshold     float64
+	failGeometricMean float64
+}
+
+var reportWriters = map[string]func(io.Writer, *report) error{
+	"table": writeTableReport,
+	"json":  writeJSONReport,
+	"csv":   writeCSVReport,
+	"junit": writeJUnitReport,
+}
+
+// failed returns true if the row is a significant regression of at least the fail threshold.
+// Without a fail threshold nothing fails.
+func (r *report) failed(row comparisonRow) bool {
+	if r.failThreshold <= 0 {
+		return false
+	}
+	return row.Comparison != nil && row.Comparison.Regression(row.Metric) && math.Abs(row.Comparison.Change) >= r.failThreshold
+}
+
+// summarize computes the geometric means of the compared rows.
+func (r *report) summarize(outlierFactor float64) *overallSummary {
+	overall := overallResult{}
+	for _, row := range r.rows {
+		if row.Comparison != nil {
+			overall.add(row.Result, row.Metric, *row.Comparison)
+		}
+	}
+	return overall.summarize(outlierFactor, r.options.Threshold)
+}
+
+// geometricMeanFailed returns true if the mean is over all test cases and regressed by at
+// least the fail threshold for geometric means. Without that threshold nothing fails.
+func (r *report) geometricMeanFailed(mean geometricMean) bool {
+	if r.failGeometricMean <= 0 {
+		return false
+	}
+	return mean.TestCase == "" && mean.regression(r.failGeometricMean)
+}
+
+// geometricMeanFailures returns the overall geometric means that make the comparison fail.
+func (r *report) geometricMeanFailures() []geometricMean {
+	var failures []geometricMean
+	for _, mean := range r.summary.overall() {
+		if r.geometricMeanFailed(mean) {
+			failures = append(failures, mean)
+		}
+	}
+	return failures
+}
+
+// failures returns the rows that make the comparison fail.
+func (r *report) failures() []comparisonRow {
+	var failures []comparisonRow
+	for _, row := range r.rows {
+		if r.failed(row) {
+			failures = append(failures, row)
+		}
+	}
+	return failures
+}
+
+func writeTableReport(output io.Writer, r *report) error {
+	renderTable(output, r.rows, r.metrics, r.summary, r.options.Threshold)
+	return nil
+}
+
+// finite returns nil for infinite and NaN values, which JSON cannot represent.
+func finite(value float64) *float64 {
+	if math.IsInf(value, 0) || math.IsNaN(value) {
+		return nil
+	}
+	return &value
+}
+
+type jsonSamples struct {
+	Median  *float64
+	MAD     *float64
+	Samples []float64
+}
+
+type jsonComparison struct {
+	Change         *float64
+	ConfidenceLow  *float64
+	ConfidenceHigh *float64
+	PValue         float64
+	Tested         bool
+	Significant    bool
+	Regression     bool
+	Failed         bool
+}
+
+type jsonRow struct {
+	Benchmark  string
+	TestCase   string
+	Metric     string
+	Unit       string
+	Old        *jsonSamples
+	New        *jsonSamples
+	Comparison *jsonComparison
+}
+
+// jsonGeometricMean is the geometric mean of the new/old ratios of a metric, in one test case
+// or, with an empty TestCase, in all test cases. Change is the mean in percent.
+type jsonGeometricMean struct {
+	TestCase   string
+	Metric     string
+	Benchmarks int
+	Change     *float64
+	Regression bool
+	Failed     bool
+}
+
+type jsonOutlier struct {
+	Benchmark string
+	Metric    string
+	Change    *float64
+}
+
+func describeSamplesForJSON(samples []float64) *jsonSamples {
+	if samples == nil {
+		return nil
+	}
+	return &jsonSamples{
+		Median:  finite(goqtestlib.Median(samples)),
+		MAD:     finite(goqtestlib.MedianAbsoluteDeviation(samples)),
+		Samples: samples,
+	}
+}
+
+func writeJSONReport(output io.Writer, r *report) error {
+	rows := []jsonRow{}
+	for _, row := range r.rows {
+		entry := jsonRow{
+			Benchmark: row.Result.Benchmark.String(),
+			TestCase:  row.Result.TestCase,
+			Metric:    row.Metric,
+			Unit:      goqtestlib.MetricUnit(row.Metric),
+			Old:       describeSamplesForJSON(row.Samples.Old),
+			New:       describeSamplesForJSON(row.Samples.New),
+		}
+		if c := row.Comparison; c != nil {
+			entry.Comparison = &jsonComparison{
+				Change:         finite(c.Change),
+				ConfidenceLow:  finite(c.ConfidenceLow),
+				ConfidenceHigh: finite(c.ConfidenceHigh),
+				PValue:         c.PValue,
+				Tested:         c.Tested,
+				Significant:    c.Significant,
+				Regression:     c.Regression(row.Metric),
+				Failed:         r.failed(row),
+			}
+		}
+		rows = append(rows, entry)
+	}
+
+	means := []jsonGeometricMean{}
+	for _, mean := range r.summary.means {
+		means = append(means, jsonGeometricMean{
+			TestCase:   mean.TestCase,
+			Metric:     mean.Metric,
+			Benchmarks: mean.Benchmarks,
+			Change:     finite(mean.change()),
+			Regression: mean.regression(r.options.Threshold),
+			Failed:     r.geometricMeanFailed(mean),
+		})
+	}
+	outliers := []jsonOutlier{}
+	for _, outlier := range r.summary.outliers {
+		outliers = append(outliers, jsonOutlier{outlier.Name, outlier.Metric, finite((outlier.Ratio - 1) * 100)})
+	}
+
+	encoder := json.NewEncoder(output)
+	encoder.SetIndent("", "    ")
+	return encoder.Encode(struct {
+		Results        []jsonRow
+		GeometricMeans []jsonGeometricMean
+		Outliers       []jsonOutlier
+	}{rows, means, outliers})
+}
+
+func formatFloat(value float64) string {
+	return strconv.FormatFloat(value, 'g', -1, 64)
+}
+
+func writeCSVReport(output io.Writer, r *report) error {
+	writer := csv.NewWriter(output)
+	writer.Write([]string{"Benchmark", "TestCase", "Metric", "Unit",
+		"OldMedian", "OldMAD", "OldSamples", "NewMedian", "NewMAD", "NewSamples",
+		"Change", "ConfidenceLow", "ConfidenceHigh", "PValue", "Tested", "Significant", "Regression", "Failed"})
+
+	for _, row := range r.rows {
+		record := []string{row.Result.Benchmark.String(), row.Result.TestCase, row.Metric, goqtestlib.MetricUnit(row.Metric)}
+		for _, samples := range [][]float64{row.Samples.Old, row.Samples.New} {
+			if samples == nil {
+				record = append(record, "", "", "0")
+				continue
+			}
+			record = append(record, formatFloat(goqtestlib.Median(samples)), formatFloat(goqtestlib.MedianAbsoluteDeviation(samples)), strconv.Itoa(len(samples)))
+		}
+		if c := row.Comparison; c != nil {
+			record = append(record, formatFloat(c.Change), formatFloat(c.ConfidenceLow), formatFloat(c.ConfidenceHigh), formatFloat(c.PValue),
+				strconv.FormatBool(c.Tested), strconv.FormatBool(c.Significant), strconv.FormatBool(c.Regression(row.Metric)), strconv.FormatBool(r.failed(row)))
+		} else {
+			record = append(record, "", "", "", "", "false", "false", "false", "false")
+		}
+		writer.Write(record)
+	}
+
+	// the geometric means follow the benchmarks, with "geometric mean" in place of the
+	// benchmark name and an empty test case for the mean over all test cases.
+	for _, mean := range r.summary.means {
+		writer.Write([]string{"geometric mean", mean.TestCase, mean.Metric, "", "", "", "", "", "", strconv.Itoa(mean.Benchmarks),
+			formatFloat(mean.change()), "", "", "", "false", "false", strconv.FormatBool(mean.regression(r.options.Threshold)), strconv.FormatBool(r.geometricMeanFailed(mean))})
+	}
+
+	writer.Flush()
+	return writer.Error()
+}
+
+type junitMessage struct {
+	Message string `xml:"message,attr"`
+	Text    string `xml:",chardata"`
+}
+
+type junitTestCase struct {
+	ClassName string        `xml:"classname,attr"`
+	Name      string        `xml:"name,attr"`
+	Failure   *junitMessage `xml:"failure,omitempty"`
+	Skipped   *junitMessage `xml:"skipped,omitempty"`
+	SystemOut string        `xml:"system-out,omitempty"`
+}
+
+type junitTestSuite struct {
+	Name      string          `xml:"name,attr"`
+	Tests     int             `xml:"tests,attr"`
+	Failures  int             `xml:"failures,attr"`
+	Skipped   int             `xml:"skipped,attr"`
+	TestCases []junitTestCase `xml:"testcase"`
+}
+
+type junitTestSuites struct {
+	XMLName xml.Name         `xml:"testsuites"`
+	Suites  []junitTestSuite `xml:"testsuite"`
+}
+
+// writeJUnitReport writes one test suite per test case and one JUnit test case per benchmark
+// and metric. Significant regressions of at least the fail threshold are failures, and
+// benchmarks that were only measured in one of the runs are skipped. A last suite holds the
+// geometric mean of each metric over all test cases, which fails with the fail threshold for
+// geometric means.
+func writeJUnitReport(output io.Writer, r *report) error {
+	suites := junitTestSuites{}
+	suiteIndex := map[string]int{}
+
+	for _, row := range r.rows {
+		i, ok := suiteIndex[row.Result.TestCase]
+		if !ok {
+			i = len(suites.Suites)
+			suiteIndex[row.Result.TestCase] = i
+			suites.Suites = append(suites.Suites, junitTestSuite{Name: row.Result.TestCase})
+		}
+		suite := &suites.Suites[i]
+
+		benchmark := row.Result.Benchmark
+		name := benchmark.Function
+		if benchmark.Tag != "" {
+			name += ":" + benchmark.Tag
+		}
+		testCase := junitTestCase{ClassName: benchmark.Test, Name: name + " " + row.Metric}
+
+		unit := goqtestlib.MetricUnit(row.Metric)
+		if row.Comparison == nil {
+			message := "only measured in the new run"
+			if row.Samples.New == nil {
+				message = "only measured in the old run"
+			}
+			testCase.Skipped = &junitMessage{Message: message}
+			suite.Skipped++
+		} else {
+			description := fmt.Sprintf("%s -> %s: %s", describeSamples(row.Samples.Old, unit), describeSamples(row.Samples.New, unit), describeChange(row.Metric, *row.Comparison))
+			testCase.SystemOut = description
+			if r.failed(row) {
+				testCase.Failure = &junitMessage{Message: "regressed by " + formatPercentage(row.Comparison.Change), Text: description}
+				suite.Failures++
+			}
+		}
+
+		suite.Tests++
+		suite.TestCases = append(suite.TestCases, testCase)
+	}
+
+	if overall := r.summary.overall(); len(overall) > 0 {
+		suite := junitTestSuite{Name: "Overall result"}
+		for _, mean := range overall {
+			description := fmt.Sprintf("geometric mean of %v benchmarks: %s", mean.Benchmarks, describeVerdict(mean.Metric, mean.Ratio, r.options.Threshold))
+			testCase := junitTestCase{ClassName: "geometric mean", Name: mean.Metric, SystemOut: description}
+			if r.geometricMeanFailed(mean) {
+				testCase.Failure = &junitMessage{Message: "regressed by " + formatPercentage(mean.change()), Text: description}
+				suite.Failures++
+			}
+			suite.Tests++
+			suite.TestCases = append(suite.TestCases, testCase)
+		}
+		suites.Suites = append(suites.Suites, suite)
+	}
+
+	if _, err := io.WriteString(output, xml.Header); err != nil {
+		return err
+	}
+	encoder := xml.NewEncoder(output)
+	encoder.Indent("", "    ")
+	if err := encoder.Encode(&suites); err != nil {
+		return err
+	}
+	_, err := io.WriteString(output, "\n")
+	return err
+}
@@ -0,0 +1,205 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+package main
+
+import (
+	"io"
+	"math"
+	"sort"
+	"strconv"
+
+	"code.qt.io/qt/qtqa.git/src/goqtestlib"
+	"github.com/olekukonko/tablewriter"
+)
+
+type overallResultEntry struct {
+	Name     string
+	TestCase string
+	Metric   string
+	Ratio    float64
+}
+
+// overallResult collects the new/old ratios of all compared benchmarks, for summarizing
+// them as geometric means per test case and metric.
+type overallResult struct {
+	entries []overallResultEntry
+}
+
+func (o *overallResult) add(mr MergedTestResult, metric string, comparison goqtestlib.SampleComparison) {
+	// ratios are only meaningful for positive values.
+	if !(comparison.OldMedian > 0) || !(comparison.NewMedian > 0) {
+		return
+	}
+	o.entries = append(o.entries, overallResultEntry{
+		Name:     mr.Name,
+		TestCase: mr.TestCase,
+		Metric:   metric,
+		Ratio:    comparison.NewMedian / comparison.OldMedian,
+	})
+}
+
+func describeVerdict(metric string, ratio float64, threshold float64) string {
+	pChange := (ratio - 1) * 100
+	if math.Abs(pChange) < threshold {
+		return "more or less the same (" + formatPercentage(pChange) + ")"
+	} else if (pChange > 0) != goqtestlib.MetricHigherIsBetter(metric) {
+		return formatPercentage(pChange) + " :("
+	}
+	return formatPercentage(pChange) + " :)"
+}
+
+// geometricMean is the geometric mean of the ratios of the benchmarks of one metric, in one
+// test case or, with an empty TestCase, in all test cases.
+type geometricMean struct {
+	TestCase   string
+	Metric     string
+	Benchmarks int
+	Ratio      float64
+}
+
+// change returns the change described by the mean, in percent.
+func (m geometricMean) change() float64 {
+	return (m.Ratio - 1) * 100
+}
+
+// regression returns true if the mean changed for the worse by at least failThreshold percent.
+func (m geometricMean) regression(failThreshold float64) bool {
+	return (m.change() > 0) != goqtestlib.MetricHigherIsBetter(m.Metric) && math.Abs(m.change()) >= failThreshold
+}
+
+// overallSummary holds the geometric means of the ratios and the outliers excluded from them.
+type overallSummary struct {
+	means    []geometricMean
+	outliers []overallResultEntry
+}
+
+// overall returns the geometric means over all test cases, one per metric.
+func (s *overallSummary) overall() []geometricMean {
+	var overall []geometricMean
+	for _, mean := range s.means {
+		if mean.TestCase == "" {
+			overall = append(overall, mean)
+		}
+	}
+	return overall
+}
+
+// summarize computes the geometric mean of the ratios for each test case and metric, as well
+// as over all test cases per metric. Outliers are excluded from the means and listed
+// separately, so that a single noisy benchmark can't dominate the overall result. Means per
+// test case are only computed if there is more than one test case.
+func (o *overallResult) summarize(outlierFactor float64, threshold float64) *overallSummary {
+	byMetric := map[string][]overallResultEntry{}
+	metrics := []string{}
+	for _, entry := range o.entries {
+		if _, ok := byMetric[entry.Metric]; !ok {
+			metrics = append(metrics, entry.Metric)
+		}
+		byMetric[entry.Metric] = append(byMetric[entry.Metric], entry)
+	}
+	sort.Strings(metrics)
+
+	summary := &overallSummary{}
+	for _, metric := range metrics {
+		entries := byMetric[metric]
+		ratios := make([]float64, len(entries))
+		for i, entry := range entries {
+			ratios[i] = entry.Ratio
+		}
+		outliers := goqtestlib.RatioOutliers(ratios, outlierFactor, threshold)
+
+		ratiosByTestCase := map[string][]float64{}
+		testCases := []string{}
+		allRatios := []float64{}
+		for i, entry := range entries {
+			if outliers[i] {
+				summary.outliers = append(summary.outliers, entry)
+				continue
+			}
+			if _, ok := ratiosByTestCase[entry.TestCase]; !ok {
+				testCases = append(testCases, entry.TestCase)
+			}
+			ratiosByTestCase[entry.TestCase] = append(ratiosByTestCase[entry.TestCase], entry.Ratio)
+			allRatios = append(allRatios, entry.Ratio)
+		}
+		sort.Strings(testCases)
+
+		if len(testCases) > 1 {
+			for _, testCase := range testCases {
+				testCaseRatios := ratiosByTestCase[testCase]
+				summary.means = append(summary.means, geometricMean{testCase, metric, len(testCaseRatios), goqtestlib.GeometricMean(testCaseRatios)})
+			}
+		}
+		if len(allRatios) > 0 {
+			summary.means = append(summary.means, geometricMean{"", metric, len(allRatios), goqtestlib.GeometricMean(allRatios)})
+		}
+	}
+	return summary
+}
+
+// render prints the geometric means and the outliers of the summary.
+func (s *overallSummary) render(output io.Writer, threshold float64) {
+	summaryTable := tablewriter.NewWriter(output)
+	summaryTable.SetAutoFormatHeaders(false)
+	summaryTable.SetHeader([]string{"Overall result", "Metric", "Benchmarks", "Geometric mean"})
+	summaryTable.SetBorder(false)
+	for _, mean := range s.means {
+		name := mean.TestCase
+		if name == "" {
+			name = "All test cases"
+		}
+		summaryTable.Append([]string{name, mean.Metric, strconv.Itoa(mean.Benchmarks), describeVerdict(mean.Metric, mean.Ratio, threshold)})
+	}
+
+	io.WriteString(output, "\n")
+	summaryTable.Render()
+
+	if len(s.outliers) > 0 {
+		outlierTable := tablewriter.NewWriter(output)
+		outlierTable.SetAutoFormatHeaders(false)
+		outlierTable.SetHeader([]string{"Outlier", "Metric", "Change"})
+		outlierTable.SetBorder(false)
+		for _, outlier := range s.outliers {
+			outlierTable.Append([]string{outlier.Name, outlier.Metric, formatPercentage((outlier.Ratio - 1) * 100)})
+		}
+		io.WriteString(output, "\n")
+		outlierTable.Render()
+	}
+}